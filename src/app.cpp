@@ -14,28 +14,30 @@
 //   - Handles graceful shutdown via SIGINT/SIGTERM
 //   - Cleans up sockets and UDS files on exit
 //
-// Main event loop: Uses poll() to wait for UDP and UDS events, routes messages accordingly.
+// Main event loop: Uses an EventLoop (poll or epoll backend) to wait for UDP and UDS events,
+// dispatching each ready fd to its channel handler, which routes messages accordingly.
+// The io_uring backend (completion-based, see app_uring.cpp) replaces this loop when configured.
 // Error handling: Prints errors for invalid config, socket failures, and message routing issues.
 
 #include "app.h"
 #include "icd/fsl.h"
 #include <iostream>
-#include <poll.h>
 #include <csignal>
 #include <signal.h>
 #include <unistd.h>
+#include <sys/eventfd.h>
+#include <cstring>
 #include <set>
+#include <algorithm>
 #include <unordered_map>
 
 #include <thread>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
 #include <vector>
 
 #include "icd/fsl.h"
 #include "icd/fcom.h"
 #include "logger.h"
+#include "realtime.h"
 
 // Helper for UL_Destination enum to string
 static const std::unordered_map<uint16_t, const char *> UL_DestinationNames = {
@@ -44,17 +46,42 @@ static const std::unordered_map<uint16_t, const char *> UL_DestinationNames = {
     {UL_Destination::EL, "EL"}};
 
 volatile std::sig_atomic_t App::shutdown_flag_ = 0;
+int App::shutdown_event_fd_ = -1;
 
-constexpr size_t CTRL_QUEUE_MAX_SIZE = 32; // Adjust as needed
-std::queue<CtrlRequest> ctrl_queue_;
-std::mutex ctrl_queue_mutex_;
-std::condition_variable ctrl_queue_cv_;
 std::thread ctrl_worker_;
-bool ctrl_worker_running_ = true;
+std::atomic<bool> ctrl_worker_running_(true);
+
+// Uplink destination name for logs (the opcode if it has no name)
+static std::string uplinkDestinationName(uint16_t opcode)
+{
+    auto it = UL_DestinationNames.find(opcode);
+    return it != UL_DestinationNames.end() ? it->second : std::to_string(opcode);
+}
+
+// Ctrl queue capacity; out-of-range sizes fail validation, so use the default meanwhile
+static size_t ctrlQueueCapacity(const AppConfig &config)
+{
+    if (config.ctrl_queue_size < 1 || config.ctrl_queue_size > App::CTRL_QUEUE_LIMIT)
+        return App::CTRL_QUEUE_MAX_SIZE;
+    return config.ctrl_queue_size;
+}
+
+// Uplink receive batch size; out-of-range sizes fail validation, so use one buffer meanwhile
+static size_t ulBatchCount(const AppConfig &config)
+{
+    if (config.udp_receive_batch_size < 1 || config.udp_receive_batch_size > (int)MsgBatch::MAX_COUNT)
+        return 1;
+    return config.udp_receive_batch_size;
+}
 
 App::App(const AppConfig &config)
-    : config_(config),
-      udp_(config_.udp_local_port, config_.udp_remote_ip, config_.udp_remote_port)
+    : buffer_pool_(bufferPoolCapacity(config), POOL_BUFFER_SIZE, config.buffer_pool_huge_pages),
+      ctrl_queue_(ctrlQueueCapacity(config)),
+      config_(config),
+      udp_(config_.udp_local_port, config_.udp_remote_ip, config_.udp_remote_port),
+      ul_batch_(buffer_pool_, ulBatchCount(config_), config_.udp_gro ? POOL_BUFFER_SIZE : UL_MTU),
+      dl_shaper_(static_cast<uint64_t>(std::max<int64_t>(config_.udp_rate_limit_bps, 0)),
+                 static_cast<uint64_t>(std::max<int64_t>(config_.udp_rate_burst_bytes, 0)))
 {
     // Set logger level from config
     auto toLogLevel = [](const std::string &lvl) -> LogLevel
@@ -70,6 +97,10 @@ App::App(const AppConfig &config)
     Logger::info("Logging level: " + config.logging_level);
 
     // Register signal handlers for graceful shutdown
+    if (shutdown_event_fd_ < 0)
+        shutdown_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (shutdown_event_fd_ < 0)
+        throw std::runtime_error("Error creating shutdown eventfd");
     std::signal(SIGINT, App::signalHandler);
     std::signal(SIGTERM, App::signalHandler);
 
@@ -81,6 +112,55 @@ App::App(const AppConfig &config)
     // --- Configuration Validation ---
     // Collect configuration errors
     std::vector<std::string> config_errors;
+    // 0. Event loop backend and egress drop policy must be known values
+    EventLoopBackend backend;
+    if (config_.event_loop_backend != "io_uring" && !parseEventLoopBackend(config_.event_loop_backend, backend))
+        config_errors.push_back("Unknown event_loop backend '" + config_.event_loop_backend + "' (expected poll, epoll or io_uring)");
+    if (config_.event_loop_uring_entries < 1 || config_.event_loop_uring_entries > 4096)
+        config_errors.push_back("event_loop uring_entries must be between 1 and 4096");
+    if (config_.event_loop_uring_buffers < 1 || config_.event_loop_uring_buffers > 32768 ||
+        (config_.event_loop_uring_buffers & (config_.event_loop_uring_buffers - 1)) != 0)
+        config_errors.push_back("event_loop uring_buffers must be a power of two between 1 and 32768");
+    if (config_.udp_gso_max_segments < 0 || config_.udp_gso_max_segments > (int)UdpServerSocket::GSO_MAX_SEGMENTS)
+        config_errors.push_back("UDP gso_max_segments must be between 0 and " + std::to_string(UdpServerSocket::GSO_MAX_SEGMENTS));
+    if (config_.event_loop_threading != "single" && config_.event_loop_threading != "split")
+        config_errors.push_back("Unknown event_loop threading '" + config_.event_loop_threading + "' (expected single or split)");
+    if (config_.event_loop_downlink_shards < 1 || config_.event_loop_downlink_shards > MAX_DOWNLINK_SHARDS)
+        config_errors.push_back("event_loop downlink_shards must be between 1 and " + std::to_string(MAX_DOWNLINK_SHARDS));
+    // Real-time profiles: CPU lists and policies must parse, priorities must fit the policy
+    auto check_profile = [&config_errors](const ThreadProfileConfig &profile, const std::string &name)
+    {
+        std::vector<int> cpus;
+        int min_priority = 0, max_priority = 0;
+        if (!parseCpuList(profile.cpus, cpus))
+            config_errors.push_back("realtime " + name + " cpus '" + profile.cpus + "' is not a valid CPU list");
+        if (!schedPriorityRange(profile.policy, min_priority, max_priority))
+            config_errors.push_back("Unknown realtime " + name + " policy '" + profile.policy + "' (expected other, fifo or rr)");
+        else if (profile.priority < min_priority || profile.priority > max_priority)
+            config_errors.push_back("realtime " + name + " priority must be between " + std::to_string(min_priority) + " and " + std::to_string(max_priority) + " for policy " + profile.policy);
+    };
+    check_profile(config_.realtime_loop, "loop");
+    check_profile(config_.realtime_ctrl_worker, "ctrl_worker");
+    if (config_.logging_async_ring_records < 1 || config_.logging_async_ring_records > LOG_RING_RECORDS_LIMIT)
+        config_errors.push_back("logging async ring_records must be between 1 and " + std::to_string(LOG_RING_RECORDS_LIMIT));
+    if (config_.metrics_tcp_port < 0 || config_.metrics_tcp_port > 65535)
+        config_errors.push_back("metrics tcp_port must be between 0 and 65535");
+    if (config_.ctrl_queue_size < 1 || config_.ctrl_queue_size > CTRL_QUEUE_LIMIT)
+        config_errors.push_back("ctrl_status_uds queue_size must be between 1 and " + std::to_string(CTRL_QUEUE_LIMIT));
+    if (config_.udp_send_batch_size < 1 || config_.udp_send_batch_size > (int)UdpEgress::MAX_BATCH)
+        config_errors.push_back("UDP send_batch_size must be between 1 and " + std::to_string(UdpEgress::MAX_BATCH));
+    if (config_.udp_send_batch_delay_us < 0)
+        config_errors.push_back("UDP send_batch_delay_us must not be negative");
+    if (config_.udp_receive_batch_size < 1 || config_.udp_receive_batch_size > (int)MsgBatch::MAX_COUNT)
+        config_errors.push_back("UDP receive_batch_size must be between 1 and " + std::to_string(MsgBatch::MAX_COUNT));
+    if (config_.udp_egress_queue_bytes < (int64_t)UdpEgress::minQueueBytes())
+        config_errors.push_back("UDP egress_queue_bytes must be at least " + std::to_string(UdpEgress::minQueueBytes()) + " (one max size datagram)");
+    if (config_.udp_egress_drop_policy != "drop_newest" && config_.udp_egress_drop_policy != "drop_oldest")
+        config_errors.push_back("Unknown UDP egress_drop_policy '" + config_.udp_egress_drop_policy + "' (expected drop_newest or drop_oldest)");
+    if (config_.udp_rate_limit_bps < 0 || config_.udp_rate_limit_bps > (int64_t)TokenBucket::MAX_RATE_BPS)
+        config_errors.push_back("UDP rate_limit_bps must be between 0 and " + std::to_string(TokenBucket::MAX_RATE_BPS));
+    if (config_.udp_rate_burst_bytes < 1 || config_.udp_rate_burst_bytes > (int64_t)TokenBucket::MAX_BURST_BYTES)
+        config_errors.push_back("UDP rate_burst_bytes must be between 1 and " + std::to_string(TokenBucket::MAX_BURST_BYTES));
     // 1. Check all UDS mapping names exist in <client>
     for (const auto &mapping : config_.ul_uds_mapping)
     {
@@ -97,6 +177,16 @@ App::App(const AppConfig &config)
             config_errors.push_back("UDS server path is empty.");
         if (!uds_paths.insert(server.path).second)
             config_errors.push_back("Duplicate UDS server path: '" + server.path + "'");
+        if (server.batch_size < 1 || server.batch_size > (int)MsgBatch::MAX_COUNT)
+            config_errors.push_back("UDS server '" + server.name + "' batch_size must be between 1 and " + std::to_string(MsgBatch::MAX_COUNT));
+        if (server.shard < 0 || server.shard >= config_.event_loop_downlink_shards)
+            config_errors.push_back("UDS server '" + server.name + "' shard must be between 0 and downlink_shards - 1");
+        if (server.priority < 0 || server.priority > MAX_DOWNLINK_PRIORITY)
+            config_errors.push_back("UDS server '" + server.name + "' priority must be between 0 and " + std::to_string(MAX_DOWNLINK_PRIORITY));
+        if (server.weight < 1 || server.weight > MAX_DOWNLINK_WEIGHT)
+            config_errors.push_back("UDS server '" + server.name + "' weight must be between 1 and " + std::to_string(MAX_DOWNLINK_WEIGHT));
+        if (server.framing != "raw" && server.framing != "fcom_datalink")
+            config_errors.push_back("UDS server '" + server.name + "' framing '" + server.framing + "' is unknown (expected raw or fcom_datalink)");
     }
 
     for (const auto &client : config_.uds_clients)
@@ -117,6 +207,50 @@ App::App(const AppConfig &config)
         throw std::runtime_error("Configuration validation failed. See log for details.");
     }
 
+    // Uplink GRO: the receive batch needs the segment size of coalesced trains
+    if (config_.udp_gro)
+        ul_batch_.enableSegmentInfo();
+
+    // Latency: kernel receive timestamps on every receiving socket (the time a datagram was
+    // queued to the socket); without them the time recvmmsg() returned is used
+    bool kernel_timestamps = udp_.enableTimestamps();
+    ul_batch_.enableTimestamps();
+
+    // Downlink shards: shard 0 sends on udp_, the others on their own socket connected to
+    // the GSL endpoint, so no two loop threads share a socket send path
+    for (int s = 0; s < config_.event_loop_downlink_shards; ++s)
+    {
+        std::unique_ptr<DownlinkShard> shard(new DownlinkShard());
+        shard->udp = &udp_;
+        if (s > 0)
+        {
+            shard->own_udp.reset(new UdpServerSocket(0, config_.udp_remote_ip, config_.udp_remote_port));
+            if (!shard->own_udp->bindSocket() || !shard->own_udp->connectRemote())
+                throw std::runtime_error("Error creating UDP socket for downlink shard " + std::to_string(s));
+            shard->udp = shard->own_udp.get();
+        }
+        shard->egress.reset(new UdpEgress(*shard->udp, config_.udp_send_batch_size, config_.udp_egress_queue_bytes, config_.udp_send_batch_delay_us,
+                                          config_.udp_egress_drop_policy == "drop_oldest" ? EgressDropPolicy::DROP_OLDEST : EgressDropPolicy::DROP_NEWEST));
+        // Always attached: a rate set at runtime applies without restarting the loops
+        shard->egress->setShaper(&dl_shaper_);
+        shard->queue_full_drops.reset(new ErrorThrottle("Downlink egress queue full, datagrams dropped", "shard " + std::to_string(s)));
+        // UDS receive to UDP send latency, recorded when the kernel takes each datagram
+        shard->egress->setSentHook([this](const UdpEgress::DatagramTag &tag, int64_t sent_ns)
+                                   { dl_latency_[tag.id].record(sent_ns - tag.time_ns); });
+        // Parked datagrams evicted by drop_oldest (or failed later) count on their server
+        shard->egress->setDroppedHook([this](const UdpEgress::DatagramTag &tag)
+                                      { ChannelCounters::add(dl_counters_[tag.id].drops, 1); });
+        dl_shards_.push_back(std::move(shard));
+    }
+
+    if (dl_shaper_.enabled())
+        Logger::info("Downlink rate limit: " + std::to_string(dl_shaper_.rateBps()) + " bit/s, burst " +
+                     std::to_string(dl_shaper_.burstBytes()) + " bytes");
+
+    Logger::info("Buffer pool: " + std::to_string(buffer_pool_.capacity()) + " x " + std::to_string(buffer_pool_.bufferSize()) +
+                 " bytes (" + std::to_string(buffer_pool_.slabBytes() >> 20) + " MiB, " +
+                 (buffer_pool_.hugePages() ? "huge pages" : "normal pages") + ")");
+
     // Create and bind all UDS servers (downlink)
     for (const auto &server_cfg : config_.uds_servers)
     {
@@ -129,8 +263,46 @@ App::App(const AppConfig &config)
         {
             throw std::runtime_error("Error binding UDS server: " + server_cfg.path);
         }
+        kernel_timestamps = server->enableTimestamps() && kernel_timestamps;
 
+        DownlinkShard &shard = *dl_shards_[server_cfg.shard];
+        DownlinkShard::Server scheduled = {uds_servers_.size(), server_cfg.priority, server_cfg.weight};
+        shard.servers.push_back(scheduled);
         uds_servers_.push_back(std::move(server));
+        // Handler bound once per channel (framing validated above)
+        dl_framing_.push_back(server_cfg.framing == "raw" ? DL_FRAMING_RAW : DL_FRAMING_DATALINK);
+
+        // Downlink payload must fit in one datagram together with the GSL-FSL header
+        uds_server_batches_.emplace_back(new MsgBatch(buffer_pool_, server_cfg.batch_size, DL_MTU - GSL_FSL_HEADER_SIZE));
+        uds_server_batches_.back()->enableTimestamps();
+        if (shard.stage.msgs.size() < static_cast<size_t>(server_cfg.batch_size))
+            shard.stage.msgs.resize(server_cfg.batch_size);
+    }
+
+    dl_counters_.reset(new ChannelCounters[uds_servers_.size()]);
+    dl_latency_.reset(new LatencyHistogram[uds_servers_.size()]);
+
+    // Downlink staging: one header + payload iovec pair per datagram of the shard's largest server batch
+    for (auto &shard : dl_shards_)
+    {
+        std::stable_sort(shard->servers.begin(), shard->servers.end(),
+                         [](const DownlinkShard::Server &a, const DownlinkShard::Server &b)
+                         { return a.priority > b.priority; });
+
+        DownlinkStage &stage = shard->stage;
+        if (stage.msgs.empty())
+            stage.msgs.resize(1);
+        stage.headers.resize(stage.msgs.size());
+        stage.tags.resize(stage.msgs.size());
+        stage.iovecs.resize(2 * stage.msgs.size());
+        memset(stage.msgs.data(), 0, stage.msgs.size() * sizeof(mmsghdr));
+        for (size_t k = 0; k < stage.msgs.size(); ++k)
+        {
+            stage.iovecs[2 * k].iov_base = &stage.headers[k];
+            stage.iovecs[2 * k].iov_len = GSL_FSL_HEADER_SIZE;
+            stage.msgs[k].msg_hdr.msg_iov = &stage.iovecs[2 * k];
+            stage.msgs[k].msg_hdr.msg_iovlen = 2;
+        }
     }
 
     // Create all UDS clients (uplink)
@@ -139,9 +311,36 @@ App::App(const AppConfig &config)
         const std::string &name = it->first;
         const std::string &path = it->second;
         std::unique_ptr<UdsSocket> client(new UdsSocket("", path));
+
+        UplinkSendGroup &group = ul_send_groups_[name];
+        group.name = name;
+        group.client = client.get();
+        group.send_drops.reset(new ErrorThrottle("Uplink datagrams dropped", name));
+        group.iovecs.resize(ul_batch_.capacity());
+        group.msgs.resize(ul_batch_.capacity());
+        group.routes.resize(ul_batch_.capacity());
+        group.receive_ns.resize(ul_batch_.capacity());
+        memset(group.msgs.data(), 0, group.msgs.size() * sizeof(mmsghdr));
+        for (size_t k = 0; k < group.msgs.size(); ++k)
+        {
+            group.msgs[k].msg_hdr.msg_iov = &group.iovecs[k];
+            group.msgs[k].msg_hdr.msg_iovlen = 1;
+        }
+
         uds_clients_[name] = std::move(client);
     }
 
+    // Compile the uplink mapping into a dense opcode-indexed table (names validated above)
+    ul_route_table_.reset(new UplinkRoute *[UINT16_MAX + 1]());
+    for (const auto &mapping : config_.ul_uds_mapping)
+    {
+        std::unique_ptr<UplinkRoute> route(new UplinkRoute());
+        route->opcode = mapping.first;
+        route->group = &ul_send_groups_[mapping.second];
+        ul_route_table_[mapping.first] = route.get();
+        ul_routes_.push_back(std::move(route));
+    }
+
     // Create ctrl/status UDS sockets for each app
     for (const auto &entry : config_.ctrl_uds_name)
     {
@@ -159,6 +358,7 @@ App::App(const AppConfig &config)
             {
                 throw std::runtime_error("Error binding ctrl request UDS for " + ctrl_uds_name + ": " + cfg.request_path);
             }
+            kernel_timestamps = sockets.request->enableTimestamps() && kernel_timestamps;
         }
         if (!cfg.response_path.empty())
         {
@@ -174,6 +374,12 @@ App::App(const AppConfig &config)
         }
         ctrl_uds_sockets_[ctrl_uds_name] = std::move(sockets);
     }
+    if (!kernel_timestamps)
+        Logger::info("Kernel receive timestamps (SO_TIMESTAMPNS) not available on every socket, latency measured from recvmmsg()");
+
+    ctrl_queue_event_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (ctrl_queue_event_fd_ < 0)
+        throw std::runtime_error("Error creating ctrl queue eventfd");
 }
 
 void App::cleanup()
@@ -198,17 +404,77 @@ void App::cleanup()
     }
 
     // Stop ctrl worker thread
+    stopCtrlWorker();
+}
+
+App::~App()
+{
+    if (ctrl_queue_event_fd_ >= 0)
+        close(ctrl_queue_event_fd_);
+}
+
+void App::stopCtrlWorker()
+{
     ctrl_worker_running_ = false;
-    ctrl_queue_cv_.notify_one();
+    uint64_t one = 1;
+    if (write(ctrl_queue_event_fd_, &one, sizeof(one)) < 0)
+        Logger::error(std::string("[CTRL] Failed to wake ctrl worker: ") + strerror(errno));
 
     if (ctrl_worker_.joinable())
         ctrl_worker_.join();
 }
 
+bool App::enqueueCtrlRequest(CtrlRequest &&req)
+{
+    if (!ctrl_queue_.tryPush(std::move(req)))
+    {
+        ctrl_queue_stats_.dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    ctrl_queue_stats_.queued.fetch_add(1, std::memory_order_relaxed);
+
+    // Depth high-water mark (approximate: the worker may already be draining)
+    size_t depth = ctrl_queue_.size();
+    size_t max_depth = ctrl_queue_stats_.max_depth.load(std::memory_order_relaxed);
+    while (depth > max_depth && !ctrl_queue_stats_.max_depth.compare_exchange_weak(max_depth, depth, std::memory_order_relaxed))
+    {
+    }
+
+    uint64_t one = 1;
+    if (write(ctrl_queue_event_fd_, &one, sizeof(one)) < 0)
+        Logger::error(std::string("[CTRL] Failed to wake ctrl worker: ") + strerror(errno));
+    return true;
+}
+
+size_t App::bufferPoolCapacity(const AppConfig &config)
+{
+    // Out-of-range sizes add nothing here: they fail validation (the uplink batch holds
+    // one buffer meanwhile, see ulBatchCount())
+    auto batch = [](int n) -> size_t
+    { return (n > 0 && n <= (int)MsgBatch::MAX_COUNT) ? n : 0; };
+
+    size_t count = ulBatchCount(config);
+    for (const auto &server : config.uds_servers)
+        count += batch(server.batch_size);
+    if (config.event_loop_backend == "io_uring" && config.event_loop_uring_buffers > 0 &&
+        config.event_loop_uring_buffers <= 32768)
+        count += 2 * config.event_loop_uring_buffers;
+    // Ctrl: queued requests, the one being processed and the one being received
+    count += ctrlQueueCapacity(config) + 2;
+    return count;
+}
+
+// Async-signal-safe only: the flag and the eventfd write. Logging (which may allocate a
+// thread's async ring and take the logger's lock) is left to run() once the loops return
 void App::signalHandler(int signum)
 {
-    Logger::info("\nClosing application...");
     shutdown_flag_ = 1;
+    // Wake every event loop thread, not only the one the signal was delivered to
+    uint64_t one = 1;
+    if (shutdown_event_fd_ >= 0 && write(shutdown_event_fd_, &one, sizeof(one)) < 0)
+    {
+        // Nothing to do: the loops still see shutdown_flag_ on their next wakeup
+    }
 }
 
 void App::run()
@@ -241,258 +507,683 @@ void App::run()
 
     Logger::info(ctrl_status_uds);
 
+    // Before any thread starts: every thread's pages (stacks included) are locked too
+    if (config_.realtime_mlockall)
+    {
+        std::string error;
+        if (lockMemory(error))
+            Logger::info("Memory locked (mlockall)");
+        else
+            Logger::error("Failed to lock memory, continuing without it: " + error);
+    }
+
+    // Async logging: from here on the loop threads only queue their log records
+    if (config_.logging_async)
+    {
+        Logger::info("Async logging: " + std::to_string(config_.logging_async_ring_records) + " records per thread");
+        Logger::startAsync(static_cast<size_t>(config_.logging_async_ring_records));
+    }
+
+    // RAII guard to write the queued records and stop the writer on all exit paths
+    // (declared before the ctrl worker guard, so it runs after the worker has stopped)
+    struct AsyncLogGuard
+    {
+        bool active;
+        ~AsyncLogGuard()
+        {
+            if (active)
+                Logger::stopAsync();
+        }
+    } log_guard{config_.logging_async};
+
     // === Start ctrl worker thread
     ctrl_worker_running_ = true;
     ctrl_worker_ = std::thread([this]
                                {
+        applyRealtimeProfile(config_.realtime_ctrl_worker, "ctrl worker");
+        CtrlRequest req;
         while (ctrl_worker_running_) {
-            std::unique_lock<std::mutex> lock(ctrl_queue_mutex_);
-            ctrl_queue_cv_.wait(lock, [this]{ return !ctrl_queue_.empty() || !ctrl_worker_running_; });
-            while (!ctrl_queue_.empty()) {
-                CtrlRequest req = std::move(ctrl_queue_.front());
-                ctrl_queue_.pop();
-                lock.unlock();
+            // Sleep until a producer (or stopCtrlWorker()) writes the eventfd, then drain
+            uint64_t wakeups;
+            if (read(ctrl_queue_event_fd_, &wakeups, sizeof(wakeups)) < 0 && errno != EINTR) {
+                Logger::error(std::string("[CTRL] Failed to wait for ctrl requests: ") + strerror(errno));
+                break;
+            }
+            while (ctrl_queue_.tryPop(req)) {
                 processCtrlRequest(req);
-                lock.lock();
+                req = CtrlRequest();
             }
         } });
 
     // RAII guard to ensure thread is joined on all exit paths
     struct CtrlWorkerGuard
     {
-        std::thread &worker;
-        bool &running;
-        std::condition_variable &cv;
-        CtrlWorkerGuard(std::thread &w, bool &r, std::condition_variable &c) : worker(w), running(r), cv(c) {}
+        App &app;
+        explicit CtrlWorkerGuard(App &a) : app(a) {}
         ~CtrlWorkerGuard()
         {
-            running = false;
-            cv.notify_one();
-            if (worker.joinable())
-                worker.join();
+            app.stopCtrlWorker();
         }
-    } guard(ctrl_worker_, ctrl_worker_running_, ctrl_queue_cv_);
+    } guard(*this);
 
-    // === Polling and routing logic ---
-    // Layout: [0]=UDP, [1..N]=UDS servers, [N+1..]=ctrl_uds_sockets_ (request only)
-    const size_t uds_count = uds_servers_.size();
-    std::vector<std::string> ctrl_uds_names;
-    for (const auto &entry : ctrl_uds_sockets_)
+    // === Metrics endpoint (own thread, started before the loop threads take their realtime
+    // profile; stopped first on every exit path) ---
+    std::unique_ptr<MetricsServer> metrics;
+    if (!config_.metrics_uds_path.empty() || config_.metrics_tcp_port > 0)
     {
-        if (entry.second.request)
-            ctrl_uds_names.push_back(entry.first);
+        metrics.reset(new MetricsServer(config_.metrics_uds_path, config_.metrics_tcp_port, [this]
+                                        { return renderMetrics(); }));
+        std::string error;
+        if (metrics->start(error))
+        {
+            std::string where = config_.metrics_uds_path;
+            if (config_.metrics_tcp_port > 0)
+                where += (where.empty() ? "" : ", ") + std::string("127.0.0.1:") + std::to_string(config_.metrics_tcp_port);
+            Logger::info("Metrics endpoint: " + where + " (GET /metrics)");
+        }
+        else
+        {
+            Logger::error("Failed to start the metrics endpoint, continuing without it: " + error);
+            metrics.reset();
+        }
     }
 
-    const size_t nfds = 1 + uds_count + ctrl_uds_names.size();
-    std::vector<pollfd> fds(nfds);
+    // === Event loop and routing logic ---
+    bool ran = false;
+    if (config_.event_loop_backend == "io_uring")
+        ran = runUringLoop();
+    if (!ran)
+        runReadinessLoop();
+    if (shutdown_flag_)
+        Logger::info("\nClosing application...");
 
-    // UDP socket
-    fds[0].fd = udp_.getFd();
-    fds[0].events = POLLIN;
+    cleanup();
+    Logger::info("Ctrl queue stats: capacity=" + std::to_string(ctrl_queue_.capacity()) +
+                 ", queued=" + std::to_string(ctrl_queue_stats_.queued.load(std::memory_order_relaxed)) +
+                 ", dropped=" + std::to_string(ctrl_queue_stats_.dropped.load(std::memory_order_relaxed)) +
+                 ", max depth=" + std::to_string(ctrl_queue_stats_.max_depth.load(std::memory_order_relaxed)));
+    Logger::info("Graceful shutdown complete.");
+}
 
-    // UDS server sockets
-    for (size_t i = 0; i < uds_count; ++i)
+// Single mode: one loop serves every channel. Split mode: the downlink (UDS servers ->
+// UDP egress) gets its own loop thread, so a downlink burst cannot delay uplink commands.
+// Every further downlink shard always runs in its own loop thread
+void App::runReadinessLoop()
+{
+    // io_uring falls back to epoll when it is not available
+    EventLoopBackend backend = EventLoopBackend::EPOLL;
+    parseEventLoopBackend(config_.event_loop_backend, backend);
+
+    if (config_.udp_gro)
+    {
+        if (udp_.enableGro())
+            Logger::info("UDP GRO enabled on the uplink socket");
+        else
+            Logger::error("UDP GRO not supported by the kernel, receiving without it");
+    }
+    // Downlink GSO: only the readiness loops send through the shard egresses
+    if (config_.udp_gso_max_segments > 1)
     {
-        fds[1 + i].fd = uds_servers_[i]->getFd();
-        fds[1 + i].events = POLLIN;
+        bool gso = true;
+        for (auto &shard : dl_shards_)
+            gso = shard->egress->enableGso(config_.udp_gso_max_segments) && gso;
+        if (gso)
+            Logger::info("UDP GSO enabled: up to " + std::to_string(config_.udp_gso_max_segments) + " datagrams per send");
+        else
+            Logger::error("UDP GSO not supported by the kernel, sending without it");
     }
 
-    // ctrl_uds_sockets_ (requests only)
-    for (size_t i = 0; i < ctrl_uds_names.size(); ++i)
+    std::vector<std::thread> workers;
+    for (size_t s = 1; s < dl_shards_.size(); ++s)
     {
-        const auto &ctrl_uds_name = ctrl_uds_names[i];
-        const auto &sockets = ctrl_uds_sockets_.at(ctrl_uds_name);
-        int fd = -1;
-        if (sockets.request)
-            fd = sockets.request->getFd();
-        fds[1 + uds_count + i].fd = fd;
-        fds[1 + uds_count + i].events = POLLIN;
+        if (dl_shards_[s]->servers.empty())
+        {
+            Logger::info("Downlink shard " + std::to_string(s) + " has no UDS servers, not started");
+            continue;
+        }
+        workers.emplace_back([this, backend, s]
+                             { serveChannels(backend, LOOP_DOWNLINK, *dl_shards_[s], "downlink shard " + std::to_string(s)); });
     }
 
-    char buffer[DL_MTU];
-    uint32_t msg_id_counter = 1;
+    std::string name = backend == EventLoopBackend::EPOLL ? "epoll" : "poll";
+    if (config_.event_loop_threading == "split")
+    {
+        workers.emplace_back([this, backend]
+                             { serveChannels(backend, LOOP_DOWNLINK, *dl_shards_[0], "downlink"); });
+        serveChannels(backend, LOOP_UPLINK, *dl_shards_[0], "uplink");
+        name += ", split";
+    }
+    else
+    {
+        serveChannels(backend, LOOP_UPLINK | LOOP_DOWNLINK, *dl_shards_[0], "all");
+    }
 
-    while (!shutdown_flag_)
+    for (auto &worker : workers)
+        worker.join();
+    if (dl_shards_.size() > 1)
+        name += ", " + std::to_string(dl_shards_.size()) + " downlink shards";
+    logLoopStats(name.c_str());
+}
+
+// One handler per channel: UDP (uplink and/or egress POLLOUT), each UDS server, each ctrl
+// request socket, plus the shutdown eventfd so every loop thread wakes on SIGINT/SIGTERM
+void App::serveChannels(EventLoopBackend backend, uint32_t channels, DownlinkShard &shard, const std::string &role)
+{
+    applyRealtimeProfile(config_.realtime_loop, "loop " + role);
+
+    std::unique_ptr<EventLoop> loop = EventLoop::create(backend);
+    std::vector<std::unique_ptr<EventHandler>> handlers;
+    const bool uplink = (channels & LOOP_UPLINK) != 0;
+    const bool downlink = (channels & LOOP_DOWNLINK) != 0;
+
+    // Never drained: stays readable so every loop sees it
+    bool shutdown_seen = false;
+    handlers.emplace_back(new CallbackHandler([&shutdown_seen](uint32_t)
+                                              { shutdown_seen = true; }));
+    loop->add(shutdown_event_fd_, EVENT_READ, handlers.back().get());
+
+    // Uplink reads udp_; the downlink watches its shard's socket for POLLOUT. When one loop
+    // does both on udp_, a single registration is modified instead
+    EventHandler *udp_handler = new CallbackHandler([this, &shard](uint32_t events)
+                                                    { onUdpEvent(shard, events); });
+    handlers.emplace_back(udp_handler);
+    const bool shared_udp = uplink && downlink && shard.udp == &udp_;
+    if (uplink)
+        loop->add(udp_.getFd(), EVENT_READ, udp_handler);
+
+    if (downlink)
     {
-        int ret = poll(fds.data(), nfds, -1);
+        // Readable servers are only marked here; scheduleDownlink() drains them by priority
+        for (DownlinkShard::Server &server : shard.servers)
+        {
+            handlers.emplace_back(new CallbackHandler([&server](uint32_t)
+                                                      { server.ready = true; }));
+            loop->add(uds_servers_[server.index]->getFd(), EVENT_READ, handlers.back().get());
+        }
+    }
+
+    if (uplink)
+    {
+        for (const auto &entry : ctrl_uds_sockets_)
+        {
+            if (!entry.second.request)
+                continue;
+            const std::string ctrl_uds_name = entry.first;
+            handlers.emplace_back(new CallbackHandler([this, ctrl_uds_name](uint32_t)
+                                                      { onCtrlRequestReadable(ctrl_uds_name); }));
+            loop->add(entry.second.request->getFd(), EVENT_READ, handlers.back().get());
+        }
+    }
+
+    Logger::info(std::string("Event loop backend: ") + loop->name() + " (" + role + "), channels: " + std::to_string(handlers.size() - 1));
+
+    UdpEgress &egress = *shard.egress;
+    bool udp_write_armed = false;
+    while (!shutdown_flag_ && !shutdown_seen)
+    {
+        // Wait for POLLOUT while downlink egress is parked on a full socket buffer
+        bool want_write = downlink && egress.wantsWritable();
+        if (want_write != udp_write_armed)
+        {
+            if (shared_udp)
+                loop->modify(udp_.getFd(), want_write ? (EVENT_READ | EVENT_WRITE) : EVENT_READ);
+            else if (want_write)
+                loop->add(shard.udp->getFd(), EVENT_WRITE, udp_handler);
+            else
+                loop->remove(shard.udp->getFd());
+            udp_write_armed = want_write;
+        }
+
+        // Saturated (or rate limited) link: stop watching lower priority servers so they wait
+        // in their socket buffers instead of queueing ahead of high priority traffic
+        bool backlogged = downlink && shard.backlogged();
+        if (downlink && backlogged != shard.low_paused && !shard.servers.empty())
+        {
+            for (const DownlinkShard::Server &server : shard.servers)
+            {
+                if (server.priority < shard.servers.front().priority)
+                    loop->modify(uds_servers_[server.index]->getFd(), backlogged ? 0u : static_cast<uint32_t>(EVENT_READ));
+            }
+            shard.low_paused = backlogged;
+        }
+
+        // Wake up in time to flush a delayed downlink batch or send what waits for tokens
+        int ret = loop->runOnce(downlink ? egress.timeoutMs() : -1);
         if (ret < 0)
         {
+            if (errno == EINTR)
+                continue;
             Logger::error(std::string("Poll failed: ") + ::strerror(errno));
             break;
         }
+        loop_stats_.wakeups.fetch_add(1, std::memory_order_relaxed);
+
+        // --- Downlink: drain ready servers, then send what this iteration produced (or wait for max delay) ---
+        if (downlink)
+        {
+            scheduleDownlink(shard);
+            egress.flushIfDue();
+            shard.egress_queued_bytes.store(egress.queuedBytes(), std::memory_order_relaxed);
+            shard.egress_queued_datagrams.store(egress.pending(), std::memory_order_relaxed);
+        }
+    }
+
+    if (downlink)
+        egress.flush();
+}
+
+void App::logLoopStats(const char *backend) const
+{
+    uint64_t wakeups = loop_stats_.wakeups.load(std::memory_order_relaxed);
+    uint64_t dl_datagrams = loop_stats_.dl_datagrams.load(std::memory_order_relaxed);
+    uint64_t ul_datagrams = loop_stats_.ul_datagrams.load(std::memory_order_relaxed);
+    uint64_t datagrams = dl_datagrams + ul_datagrams;
+    std::string per_wakeup = "0";
+    if (wakeups > 0)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.2f", static_cast<double>(datagrams) / wakeups);
+        per_wakeup = buf;
+    }
+    Logger::info(std::string("Event loop stats (") + backend + "): wakeups=" + std::to_string(wakeups) +
+                 ", downlink=" + std::to_string(dl_datagrams) +
+                 ", uplink=" + std::to_string(ul_datagrams) +
+                 ", datagrams/wakeup=" + per_wakeup);
+
+    UdpEgress::Stats egress = {};
+    for (const auto &shard : dl_shards_)
+    {
+        const UdpEgress::Stats &stats = shard->egress->stats();
+        egress.send_calls += stats.send_calls;
+        egress.datagrams += stats.datagrams;
+        egress.gso_sends += stats.gso_sends;
+        egress.gso_datagrams += stats.gso_datagrams;
+        egress.shaper_waits += stats.shaper_waits;
+    }
+    if (egress.send_calls > 0)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.2f", static_cast<double>(egress.datagrams) / egress.send_calls);
+        Logger::info("Downlink egress stats: send calls=" + std::to_string(egress.send_calls) +
+                     ", datagrams=" + std::to_string(egress.datagrams) + ", datagrams/call=" + buf +
+                     ", gso sends=" + std::to_string(egress.gso_sends) +
+                     ", gso datagrams=" + std::to_string(egress.gso_datagrams) +
+                     ", shaper waits=" + std::to_string(egress.shaper_waits));
+    }
+
+    std::string routes = "Uplink route stats:";
+    for (const auto &route : ul_routes_)
+    {
+        routes += " opcode " + std::to_string(route->opcode) + " -> " + route->group->name + ": " +
+                  std::to_string(route->counters.datagrams.load(std::memory_order_relaxed)) + " datagrams, " +
+                  std::to_string(route->counters.bytes.load(std::memory_order_relaxed)) + " bytes, " +
+                  std::to_string(route->counters.drops.load(std::memory_order_relaxed)) + " dropped;";
+    }
+    Logger::info(routes + " unrouted=" + std::to_string(ul_unrouted_.load(std::memory_order_relaxed)));
+}
+
+void App::applyRealtimeProfile(const ThreadProfileConfig &profile, const std::string &thread_name)
+{
+    if (profile.cpus.empty() && profile.policy == "other" && profile.priority == 0)
+        return;
+
+    std::string error;
+    std::string description = "cpus=" + (profile.cpus.empty() ? std::string("any") : profile.cpus) +
+                              ", policy=" + profile.policy + ", priority=" + std::to_string(profile.priority);
+    if (applyThreadProfile(profile.cpus, profile.policy, profile.priority, error))
+        Logger::info("Thread profile (" + thread_name + "): " + description);
+    else
+        Logger::error("Failed to apply thread profile (" + thread_name + "), continuing without it: " + error);
+}
+
+// --- UDP socket events ---
+void App::onUdpEvent(DownlinkShard &shard, uint32_t events)
+{
+    // --- UDP writable again: resume parked downlink egress ---
+    if (events & EVENT_WRITE)
+    {
+        shard.egress->onWritable();
+    }
+
+    // --- UDP -> UDS client (uplink) ---
+    // Each wakeup drains up to receive_batch_size datagrams with one recvmmsg()
+    if (events & EVENT_READ)
+    {
+        int count = udp_.receiveBatch(ul_batch_);
+        if (count > 0)
+        {
+            routeUplinkBatch(ul_batch_);
+        }
+        else if (count < 0)
+        {
+            FSL_LOG_ERROR("Failed to receive from UDP socket");
+        }
+    }
+}
+
+// --- Downlink scheduler ---
+// Levels are served from the highest priority down; a lower level only gets its turn when
+// the levels above are drained (or out of rounds) and the egress is not backlogged. Within
+// a level, each round grants every ready server weight * DRR_QUANTUM_DATAGRAMS datagrams.
+void App::scheduleDownlink(DownlinkShard &shard)
+{
+    std::vector<DownlinkShard::Server> &servers = shard.servers;
+    size_t level_begin = 0;
+    while (level_begin < servers.size())
+    {
+        size_t level_end = level_begin;
+        while (level_end < servers.size() && servers[level_end].priority == servers[level_begin].priority)
+            ++level_end;
+        if (level_begin > 0 && shard.backlogged())
+            break;
 
-        // --- UDP -> UDS client (uplink) ---
-        if (fds[0].revents & POLLIN)
+        for (int round = 0; round < DRR_ROUNDS_PER_WAKEUP; ++round)
         {
-            sockaddr_in sender_addr;
-            socklen_t sender_len = sizeof(sender_addr);
-            int n = udp_.receive(buffer, sizeof(buffer), &sender_addr);
-            if (n >= (int)GSL_FSL_HEADER_SIZE)
+            bool pending = false;
+            for (size_t k = level_begin; k < level_end; ++k)
             {
-                // determine UL_Destination from gsl-fsl-header opcode
-                // pill off gsl-fsl header and send only payload via UDS
-                const GslFslHeader *hdr = static_cast<const GslFslHeader *>(static_cast<const void *>(buffer));
-                UL_Destination dest = static_cast<UL_Destination>(hdr->opcode); // opcode is actually destination for uplink
-                std::map<uint16_t, std::string>::const_iterator map_it = config_.ul_uds_mapping.find(static_cast<uint16_t>(dest));
-                if (map_it != config_.ul_uds_mapping.end())
+                DownlinkShard::Server &server = servers[k];
+                if (!server.ready)
+                    continue;
+                server.deficit += static_cast<int64_t>(server.weight) * DRR_QUANTUM_DATAGRAMS;
+                while (server.ready && server.deficit > 0)
                 {
-                    const std::string &ctrl_uds_name = map_it->second;
-                    std::map<std::string, std::unique_ptr<UdsSocket>>::iterator client_it = uds_clients_.find(ctrl_uds_name);
-                    if (client_it != uds_clients_.end())
+                    size_t max_count = static_cast<size_t>(server.deficit);
+                    int count = receiveDownlink(server.index, max_count);
+                    if (count < static_cast<int>(std::min(max_count, uds_server_batches_[server.index]->capacity())))
                     {
-                        // Forward only the payload (excluding gsl-fsl-header)
-                        ssize_t sent = client_it->second->send(buffer + GSL_FSL_HEADER_SIZE, n - GSL_FSL_HEADER_SIZE);
-                        if (sent < 0)
-                        {
-                            Logger::error("Failed to send to UDS client '" + ctrl_uds_name + "' (dest: " + std::to_string(dest) + ")");
-                        }
-                        else
-                        {
-                            if (Logger::isDebugEnabled())
-                            {
-                                auto it = UL_DestinationNames.find(dest);
-                                std::string dest_name = (it != UL_DestinationNames.end()) ? it->second : std::to_string(dest);
-                                Logger::debug("Routed UDP->UDS: dest=" + dest_name + ", bytes=" + std::to_string(sent) + ", uds='" + ctrl_uds_name + "'");
-                            }
-                        }
+                        // Drained (or failed): an idle server keeps no credit
+                        server.ready = false;
+                        server.deficit = 0;
                     }
                     else
                     {
-                        Logger::error("No UDS client found for name: " + ctrl_uds_name);
+                        server.deficit -= count;
                     }
                 }
-                else
-                {
-                    Logger::error("No UDS mapping for dest: " + std::to_string(dest));
-                }
+                pending = pending || server.ready;
             }
+            if (!pending)
+                break;
         }
+        level_begin = level_end;
+    }
+}
 
-        // --- UDS server(s) -> UDP (downlink) ---
-        for (size_t i = 0; i < uds_count; ++i)
+// --- UDS server -> UDP (downlink) ---
+// One recvmmsg() of up to min(batch_size, max_count) datagrams
+int App::receiveDownlink(size_t i, size_t max_count)
+{
+    MsgBatch &batch = *uds_server_batches_[i];
+    int count = uds_servers_[i]->receiveBatch(batch, max_count);
+    if (count < 0)
+        return -1; // reported by the socket
+
+    DownlinkShard &shard = *dl_shards_[config_.uds_servers[i].shard];
+    ChannelCounters &counters = dl_counters_[i];
+    ChannelCounters::add(counters.datagrams, count);
+    int64_t received_ns = 0; // receive time when the kernel did not stamp a datagram
+    for (int k = 0; k < count; ++k)
+    {
+        size_t n = batch.length(k);
+        ChannelCounters::add(counters.bytes, n);
+        if (batch.truncated(k))
+            ChannelCounters::add(counters.truncated, 1);
+        if (n == 0)
+            continue;
+
+        // Staged as header + payload segments: the payload is sent from the receive buffer
+        GslFslHeader hdr;
+        int offset = frameDownlink(i, batch.data(k), n, hdr, dl_seq_id_);
+        int64_t receive_ns = batch.receiveTimeNs(k);
+        if (receive_ns == 0)
+            receive_ns = received_ns != 0 ? received_ns : (received_ns = LatencyHistogram::nowNs());
+        int sent = offset < 0 ? -1 : stageDownlink(shard, batch.data(k) + offset, hdr, {static_cast<uint32_t>(i), receive_ns});
+        if (sent < 0)
         {
-            if (fds[1 + i].revents & POLLIN)
-            {
-                int n = uds_servers_[i]->receive(buffer + GSL_FSL_HEADER_SIZE, sizeof(buffer) - GSL_FSL_HEADER_SIZE);
-                if (n > 0)
-                {
-                    std::string server_name;
-                    if (i < config_.uds_servers.size())
-                        server_name = config_.uds_servers[i].name;
+            ChannelCounters::add(counters.drops, 1);
+            FSL_LOG_ERROR("Failed to send UDP packet from UDS server index %zu", i);
+        }
+        else
+        {
+            loop_stats_.dl_datagrams.fetch_add(1, std::memory_order_relaxed);
+            FSL_LOG_DEBUG("Routed UDS->UDP: bytes=%d, src='%s' (server: '%s')", sent, uds_servers_[i]->getMyPath().c_str(), config_.uds_servers[i].name.c_str());
+        }
+    }
 
-                    std::vector<uint8_t> downlink_data(buffer + GSL_FSL_HEADER_SIZE, buffer + GSL_FSL_HEADER_SIZE + n);
+    // Before the batch buffers are reused: send directly or gather what must wait into the egress ring
+    size_t dropped = flushDownlink(shard);
+    if (dropped > 0)
+        ChannelCounters::add(counters.drops, dropped);
+    if (shard.egress->wantsWritable())
+        ChannelCounters::add(counters.eagain, 1);
+    return count;
+}
 
-                    int sent = processDownlinkMessage(server_name, downlink_data, msg_id_counter);
-                    if (sent < 0)
-                    {
-                        Logger::error("Failed to send UDP packet from UDS server index " + std::to_string(i));
-                    }
-                    else
-                    {
-                        if (Logger::isDebugEnabled())
-                        {
-                            Logger::debug("Routed UDS->UDP: bytes=" + std::to_string(sent) + ", src='" + uds_servers_[i]->getMyPath() + "' (server: '" + server_name + "')");
-                        }
-                    }
-                }
-                else if (n < 0)
-                {
-                    Logger::error("Failed to receive from UDS server index " + std::to_string(i));
-                }
-            }
+// --- ctrl_uds_sockets_ (request only) ---
+void App::onCtrlRequestReadable(const std::string &ctrl_uds_name)
+{
+    std::map<std::string, CtrlUdsSockets>::iterator it = ctrl_uds_sockets_.find(ctrl_uds_name);
+    UdsSocket &request = *it->second.request;
+    ChannelCounters &counters = *it->second.counters;
+
+    // Receive straight into a pool buffer; the worker thread takes it over
+    PoolBuffer buffer = buffer_pool_.acquire();
+    if (!buffer)
+    {
+        // Consume the datagram anyway so the socket does not stay readable
+        uint8_t discard;
+        if (request.receive(&discard, sizeof(discard)) >= 0)
+        {
+            ChannelCounters::add(counters.datagrams, 1);
+            ChannelCounters::add(counters.drops, 1);
+        }
+        Logger::error("[CTRL] Buffer pool exhausted, dropping request for '" + ctrl_uds_name + "'");
+        return;
+    }
+
+    int64_t receive_ns;
+    int n = request.receive(buffer.data(), buffer.capacity(), receive_ns);
+    if (n > 0)
+    {
+        FSL_LOG_DEBUG("[CTRL] Received request for '%s', bytes=%d", ctrl_uds_name.c_str(), n);
+        ChannelCounters::add(counters.datagrams, 1);
+        ChannelCounters::add(counters.bytes, n);
+        if (static_cast<size_t>(n) == buffer.capacity())
+            ChannelCounters::add(counters.truncated, 1); // filled the buffer: may have been cut
+        // Producer: enqueue ctrl request for worker thread
+        buffer.setLength(n);
+        CtrlRequest req;
+        req.ctrl_uds_name = it->first.c_str();
+        req.data = std::move(buffer);
+        req.receive_ns = receive_ns != 0 ? receive_ns : LatencyHistogram::nowNs();
+        req.latency = it->second.latency.get();
+        if (!enqueueCtrlRequest(std::move(req)))
+        {
+            // Buffer full: handle error (log, respond, etc.)
+            ChannelCounters::add(counters.drops, 1);
+            Logger::error("[CTRL] Queue full, dropping request for '" + ctrl_uds_name + "'");
+            // TODO: Optionally send FSL_CTRL_ERR_QUEUE_FULL response to client
+        }
+    }
+    else if (n < 0)
+    {
+        Logger::error("[CTRL] Failed to receive request for '" + ctrl_uds_name + "'");
+    }
+}
+
+// --- Uplink router ---
+// Pass 1 resolves the destination of every datagram in the batch and stages its
+// payload (GSL-FSL header peeled off) in the per-client send group; pass 2 sends
+// each group with a single sendmmsg(). Per-destination ordering is preserved.
+void App::routeUplinkBatch(MsgBatch &batch)
+{
+    int64_t received_ns = 0; // receive time when the kernel did not stamp a datagram
+    for (size_t k = 0; k < batch.size(); ++k)
+    {
+        size_t length = batch.length(k);
+        size_t segment = batch.segmentSize(k);
+        int64_t receive_ns = batch.receiveTimeNs(k);
+        if (receive_ns == 0)
+            receive_ns = received_ns != 0 ? received_ns : (received_ns = LatencyHistogram::nowNs());
+        if (segment == 0)
+        {
+            stageUplink(batch.data(k), length, batch.truncated(k), receive_ns);
+            continue;
         }
 
-        // --- ctrl_uds_sockets_ (request only) handlers ---
-        for (size_t i = 0; i < ctrl_uds_names.size(); ++i)
+        // GRO train: segment-sized GSL-FSL frames back to back (the last may be shorter)
+        for (size_t offset = 0; offset < length; offset += segment)
+        {
+            stageUplink(batch.data(k) + offset, std::min(segment, length - offset), batch.truncated(k) && offset + segment >= length, receive_ns);
+        }
+    }
+    flushUplink();
+}
+
+// Stage one GSL-FSL framed uplink datagram in the send group of its UDS client
+// The payload is referenced, not copied: data must stay valid until flushUplink()
+void App::stageUplink(uint8_t *data, size_t n, bool truncated, int64_t receive_ns)
+{
+    if (n < GSL_FSL_HEADER_SIZE)
+        return;
+
+    // determine UL_Destination from gsl-fsl-header opcode (opcode is actually destination for uplink)
+    const GslFslHeader *hdr = static_cast<const GslFslHeader *>(static_cast<const void *>(data));
+    UplinkRoute *route = ul_route_table_[hdr->opcode];
+    if (!route)
+    {
+        ul_unrouted_.fetch_add(1, std::memory_order_relaxed);
+        ul_unrouted_errors_.report(0);
+        FSL_LOG_DEBUG("No UDS mapping for dest: %u", static_cast<unsigned>(hdr->opcode));
+        return;
+    }
+
+    // Stage only the payload (excluding gsl-fsl-header)
+    UplinkSendGroup &group = *route->group;
+    if (group.count == group.msgs.size())
+        flushUplinkGroup(group);
+    group.iovecs[group.count].iov_base = data + GSL_FSL_HEADER_SIZE;
+    group.iovecs[group.count].iov_len = n - GSL_FSL_HEADER_SIZE;
+    group.routes[group.count] = route;
+    group.receive_ns[group.count] = receive_ns;
+    ++group.count;
+    ChannelCounters::add(route->counters.datagrams, 1);
+    ChannelCounters::add(route->counters.bytes, n - GSL_FSL_HEADER_SIZE);
+    if (truncated)
+        ChannelCounters::add(route->counters.truncated, 1);
+    loop_stats_.ul_datagrams.fetch_add(1, std::memory_order_relaxed);
+
+    FSL_LOG_DEBUG("Routed UDP->UDS: dest=%s, bytes=%zu, uds='%s'", uplinkDestinationName(hdr->opcode).c_str(), n - GSL_FSL_HEADER_SIZE, group.name.c_str());
+}
+
+// Send every staged uplink datagram, one sendmmsg() per destination UDS client
+void App::flushUplink()
+{
+    for (auto &entry : ul_send_groups_)
+    {
+        if (entry.second.count > 0)
+            flushUplinkGroup(entry.second);
+    }
+}
+
+void App::flushUplinkGroup(UplinkSendGroup &group)
+{
+    size_t sent = 0;
+    bool full = false; // client socket buffer full (EAGAIN)
+    if (group.count == 1)
+    {
+        // A single datagram needs no mmsghdr array: plain sendmsg()
+        if (group.client->sendv(&group.iovecs[0], 1) >= 0)
+            sent = 1;
+        else
+            full = (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    else
+    {
+        while (sent < group.count)
         {
-            if (fds[1 + uds_count + i].revents & POLLIN)
+            int ret = group.client->sendBatch(group.msgs.data() + sent, group.count - sent);
+            if (ret <= 0)
             {
-                const std::string &ctrl_uds_name = ctrl_uds_names[i];
-                int n = ctrl_uds_sockets_[ctrl_uds_name].request->receive(buffer, sizeof(buffer));
-                if (n > 0)
-                {
-                    if (Logger::isDebugEnabled())
-                    {
-                        Logger::debug("[CTRL] Received request for '" + ctrl_uds_name + "', bytes=" + std::to_string(n));
-                    }
-                    // Producer: enqueue ctrl request for worker thread
-                    CtrlRequest req;
-                    req.ctrl_uds_name = ctrl_uds_name;
-                    req.data.assign(buffer, buffer + n);
-                    bool queued = false;
-                    {
-                        std::lock_guard<std::mutex> lock(ctrl_queue_mutex_);
-                        if (ctrl_queue_.size() < CTRL_QUEUE_MAX_SIZE)
-                        {
-                            ctrl_queue_.push(std::move(req));
-                            queued = true;
-                        }
-                    }
-                    if (queued)
-                    {
-                        ctrl_queue_cv_.notify_one();
-                    }
-                    else
-                    {
-                        // Buffer full: handle error (log, respond, etc.)
-                        Logger::error("[CTRL] Queue full, dropping request for '" + ctrl_uds_name + "'");
-                        // TODO: Optionally send FSL_CTRL_ERR_QUEUE_FULL response to client
-                    }
-                }
-                else if (n < 0)
-                {
-                    Logger::error("[CTRL] Failed to receive request for '" + ctrl_uds_name + "'");
-                }
+                full = ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+                break;
             }
+            sent += ret;
         }
     }
 
-    cleanup();
-    Logger::info("Graceful shutdown complete.");
+    if (sent > 0)
+    {
+        int64_t sent_ns = LatencyHistogram::nowNs();
+        for (size_t k = 0; k < sent; ++k)
+        {
+            if (group.receive_ns[k] != 0)
+                group.routes[k]->latency.record(sent_ns - group.receive_ns[k]);
+        }
+    }
+
+    if (sent < group.count)
+    {
+        group.send_drops->report(0, group.count - sent);
+        // Charge every datagram the client did not take to its route
+        for (size_t k = sent; k < group.count; ++k)
+        {
+            ChannelCounters::add(group.routes[k]->counters.drops, 1);
+            if (full)
+                ChannelCounters::add(group.routes[k]->counters.eagain, 1);
+        }
+    }
+    group.count = 0;
 }
 
 void App::processCtrlRequest(const CtrlRequest &req)
 {
-    // The control request handlers require non-const data for processing
-    if (req.ctrl_uds_name == "FSW")
+    const uint8_t *data = req.data.data();
+    size_t length = req.data.length();
+    if (strcmp(req.ctrl_uds_name, "FSW") == 0)
     {
-        processFSWCtrlRequest(const_cast<std::vector<uint8_t> &>(req.data)); // Intentional: handler may modify data
+        processFSWCtrlRequest(data, length);
     }
-    else if (req.ctrl_uds_name == "PLMG")
+    else if (strcmp(req.ctrl_uds_name, "PLMG") == 0)
     {
-        processPLMGCtrlRequest(const_cast<std::vector<uint8_t> &>(req.data)); // Intentional: handler may modify data
+        processPLMGCtrlRequest(data, length);
     }
-    else if (req.ctrl_uds_name == "EL")
+    else if (strcmp(req.ctrl_uds_name, "EL") == 0)
     {
-        processELCtrlRequest(const_cast<std::vector<uint8_t> &>(req.data)); // Intentional: handler may modify data
+        processELCtrlRequest(data, length);
     }
     else
     {
-        Logger::error("[CTRL-WORKER] Unknown ctrl_uds_name: '" + req.ctrl_uds_name + "'");
+        Logger::error(std::string("[CTRL-WORKER] Unknown ctrl_uds_name: '") + req.ctrl_uds_name + "'");
     }
+
+    // Queue wait, processing and response send
+    if (req.latency && req.receive_ns != 0)
+        req.latency->record(LatencyHistogram::nowNs() - req.receive_ns);
 }
 
-void App::processFSWCtrlRequest(std::vector<uint8_t> &data)
+void App::processFSWCtrlRequest(const uint8_t *data, size_t length)
 {
     // Handle FSW control request
     if (Logger::isDebugEnabled())
     {
-        Logger::debug("[CTRL] Processing FSW control request, bytes=" + std::to_string(data.size()));
+        Logger::debug("[CTRL] Processing FSW control request, bytes=" + std::to_string(length));
     }
-    const fcom_fsw_CS_Header *const hdr = static_cast<const fcom_fsw_CS_Header *>(static_cast<const void *>(data.data()));
+    const fcom_fsw_CS_Header *const hdr = static_cast<const fcom_fsw_CS_Header *>(static_cast<const void *>(data));
     if (Logger::isDebugEnabled())
     {
         Logger::debug("[CTRL] FSW Header: opcode=" + std::to_string(hdr->opcode) +
                       ", length=" + std::to_string(hdr->length) +
                       ", seq_id=" + std::to_string(hdr->seq_id));
     }
-    if (data.size() < sizeof(FslCtrlGeneralRequest))
+    if (length < sizeof(FslCtrlGeneralRequest))
     {
         Logger::error("[CTRL] FSW ctrl request too short");
         return;
     }
 
-    const FslCtrlGeneralRequest *req = reinterpret_cast<const FslCtrlGeneralRequest *>(data.data());
+    const FslCtrlGeneralRequest *req = reinterpret_cast<const FslCtrlGeneralRequest *>(data);
     FslCtrlOpcode opcode = req->header.ctrl_opcode;
     uint32_t seq_id = req->header.ctrl_seq_id;
 
@@ -528,6 +1219,59 @@ void App::processFSWCtrlRequest(std::vector<uint8_t> &data)
             memcpy(response.data(), &resp, sizeof(FslCtrlGetCbitResponse));
         }
         break;
+    case FSL_CTRL_OP_SET_DL_RATE:
+        // Reconfigure the downlink shaper; the loops pick it up with the next datagram.
+        // The io_uring loop does not shape, so it cannot honour a rate: refused
+        {
+            FslCtrlSetDlRateResponse resp = {};
+            resp.header.ctrl_opcode = opcode;
+            resp.header.ctrl_error_code = FSL_CTRL_ERR_NONE;
+            resp.header.ctrl_length = sizeof(FslCtrlSetDlRateResponse) - sizeof(FslCtrlHeader);
+            resp.header.ctrl_seq_id = seq_id;
+            FslCtrlSetDlRateRequest rate_req = {};
+            if (uring_active_.load(std::memory_order_relaxed))
+            {
+                resp.header.ctrl_error_code = FSL_CTRL_ERR_NOT_ALLOWED;
+            }
+            else if (length < sizeof(FslCtrlSetDlRateRequest))
+            {
+                resp.header.ctrl_error_code = FSL_CTRL_ERR_INVALID_PARAM;
+            }
+            else
+            {
+                memcpy(&rate_req, data, sizeof(rate_req));
+                if (rate_req.rate_bps > TokenBucket::MAX_RATE_BPS || rate_req.burst_bytes > TokenBucket::MAX_BURST_BYTES)
+                    resp.header.ctrl_error_code = FSL_CTRL_ERR_INVALID_PARAM;
+            }
+            if (resp.header.ctrl_error_code == FSL_CTRL_ERR_NONE)
+            {
+                uint64_t burst = rate_req.burst_bytes ? rate_req.burst_bytes : dl_shaper_.burstBytes();
+                dl_shaper_.configure(rate_req.rate_bps, burst);
+                Logger::info("[CTRL] Downlink rate limit set to " + std::to_string(dl_shaper_.rateBps()) +
+                             " bit/s, burst " + std::to_string(dl_shaper_.burstBytes()) + " bytes");
+            }
+            else if (resp.header.ctrl_error_code == FSL_CTRL_ERR_NOT_ALLOWED)
+            {
+                Logger::error("[CTRL] Downlink rate request refused: the io_uring backend does not shape");
+            }
+            else
+            {
+                Logger::error("[CTRL] Invalid downlink rate request");
+            }
+            // Refused under io_uring: nothing is in effect, the link is unlimited
+            if (resp.header.ctrl_error_code != FSL_CTRL_ERR_NOT_ALLOWED)
+            {
+                resp.rate_bps = dl_shaper_.rateBps();
+                resp.burst_bytes = static_cast<uint32_t>(dl_shaper_.burstBytes());
+            }
+            response.resize(sizeof(FslCtrlSetDlRateResponse));
+            memcpy(response.data(), &resp, sizeof(FslCtrlSetDlRateResponse));
+        }
+        break;
+    case FSL_CTRL_OP_GET_STATS:
+        // Snapshot of every channel's counters
+        response = buildStatsResponse(seq_id);
+        break;
     default:
         // Unknown/unsupported opcode
         {
@@ -549,6 +1293,8 @@ void App::processFSWCtrlRequest(std::vector<uint8_t> &data)
         ssize_t sent = it->second.response->send(response.data(), response.size());
         if (sent < 0)
         {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                ChannelCounters::add(it->second.counters->eagain, 1);
             Logger::error("[CTRL] Failed to send FSW ctrl response");
         }
         else if (Logger::isDebugEnabled())
@@ -562,21 +1308,166 @@ void App::processFSWCtrlRequest(std::vector<uint8_t> &data)
     }
 }
 
-void App::processPLMGCtrlRequest(std::vector<uint8_t> &data)
+std::vector<uint8_t> App::buildStatsResponse(uint32_t seq_id) const
+{
+    std::vector<FslStatsRecord> records;
+    auto add_record = [&records](FslStatsChannelType type, uint16_t id, const ChannelCounters &counters, const LatencyHistogram &latency)
+    {
+        LatencyHistogram::Snapshot snapshot = latency.snapshot();
+        FslStatsRecord record = {};
+        record.type = type;
+        record.id = id;
+        record.datagrams = counters.datagrams.load(std::memory_order_relaxed);
+        record.bytes = counters.bytes.load(std::memory_order_relaxed);
+        record.drops = counters.drops.load(std::memory_order_relaxed);
+        record.eagain = counters.eagain.load(std::memory_order_relaxed);
+        record.truncated = counters.truncated.load(std::memory_order_relaxed);
+        record.latency_count = snapshot.count;
+        record.latency_p50_ns = snapshot.percentile(0.5);
+        record.latency_p99_ns = snapshot.percentile(0.99);
+        record.latency_p999_ns = snapshot.percentile(0.999);
+        record.latency_max_ns = snapshot.max_ns;
+        records.push_back(record);
+    };
+    for (size_t i = 0; i < uds_servers_.size(); ++i)
+        add_record(FSL_STATS_DL_SERVER, static_cast<uint16_t>(i), dl_counters_[i], dl_latency_[i]);
+    for (const auto &route : ul_routes_)
+        add_record(FSL_STATS_UL_ROUTE, route->opcode, route->counters, route->latency);
+    uint16_t ctrl_index = 0;
+    for (const auto &entry : ctrl_uds_sockets_)
+        add_record(FSL_STATS_CTRL, ctrl_index++, *entry.second.counters, *entry.second.latency);
+
+    FslCtrlGetStatsResponse resp = {};
+    size_t size = sizeof(FslCtrlGetStatsResponse) + records.size() * sizeof(FslStatsRecord);
+    resp.header.ctrl_opcode = FSL_CTRL_OP_GET_STATS;
+    resp.header.ctrl_error_code = FSL_CTRL_ERR_NONE;
+    resp.header.ctrl_length = static_cast<uint16_t>(size - sizeof(FslCtrlHeader));
+    resp.header.ctrl_seq_id = seq_id;
+    resp.record_count = static_cast<uint16_t>(records.size());
+    resp.ul_unrouted = ul_unrouted_.load(std::memory_order_relaxed);
+
+    std::vector<uint8_t> response(size);
+    memcpy(response.data(), &resp, sizeof(resp));
+    if (!records.empty())
+        memcpy(response.data() + sizeof(resp), records.data(), records.size() * sizeof(FslStatsRecord));
+    return response;
+}
+
+std::string App::renderMetrics() const
+{
+    OpenMetricsText text;
+    auto load = [](const std::atomic<uint64_t> &value)
+    {
+        return value.load(std::memory_order_relaxed);
+    };
+
+    // Channel counters: one family per counter, one sample per channel
+    struct ChannelLabels
+    {
+        std::string labels;
+        const ChannelCounters *counters;
+        const LatencyHistogram *latency;
+    };
+    std::vector<ChannelLabels> channels;
+    for (size_t i = 0; i < uds_servers_.size(); ++i)
+        channels.push_back({OpenMetricsText::labels({{"direction", "downlink"}, {"channel", config_.uds_servers[i].name}}), &dl_counters_[i], &dl_latency_[i]});
+    for (const auto &route : ul_routes_)
+        channels.push_back({OpenMetricsText::labels({{"direction", "uplink"}, {"channel", route->group->name}, {"opcode", std::to_string(route->opcode)}}), &route->counters, &route->latency});
+    for (const auto &entry : ctrl_uds_sockets_)
+        channels.push_back({OpenMetricsText::labels({{"direction", "ctrl"}, {"channel", entry.first}}), entry.second.counters.get(), entry.second.latency.get()});
+
+    struct ChannelFamily
+    {
+        const char *name;
+        const char *help;
+        std::atomic<uint64_t> ChannelCounters::*counter;
+    };
+    static const ChannelFamily families[] = {
+        {"fsl_channel_datagrams", "Datagrams received on the channel", &ChannelCounters::datagrams},
+        {"fsl_channel_bytes", "Bytes received on the channel", &ChannelCounters::bytes},
+        {"fsl_channel_drops", "Datagrams dropped on the channel", &ChannelCounters::drops},
+        {"fsl_channel_eagain", "Sends that failed with EAGAIN (receiver or link not keeping up)", &ChannelCounters::eagain},
+        {"fsl_channel_truncated", "Datagrams truncated by the receive buffer", &ChannelCounters::truncated},
+    };
+    for (const ChannelFamily &family : families)
+    {
+        text.family(family.name, "counter", family.help);
+        for (const ChannelLabels &channel : channels)
+            text.sample(std::string(family.name) + "_total", channel.labels, load(channel.counters->*family.counter));
+    }
+
+    // Latency: bucket bounds at every other power of two (1 us .. 17 s) fall on histogram
+    // bucket edges, so the cumulative counts are exact
+    text.family("fsl_latency_seconds", "histogram", "Time inside FSL: downlink UDS receive to UDP send, uplink UDP receive to UDS send, ctrl request receive to processed");
+    std::vector<LatencyHistogram::Snapshot> snapshots;
+    for (const ChannelLabels &channel : channels)
+    {
+        snapshots.push_back(channel.latency->snapshot());
+        const LatencyHistogram::Snapshot &snapshot = snapshots.back();
+        for (int bits = 10; bits <= 34; bits += 2)
+        {
+            char le[32];
+            snprintf(le, sizeof(le), "%.9g", ((1ull << bits) - 1) / 1e9);
+            text.sample("fsl_latency_seconds_bucket", channel.labels + ",le=\"" + le + "\"", snapshot.countAtOrBelow((1ull << bits) - 1));
+        }
+        text.sample("fsl_latency_seconds_bucket", channel.labels + ",le=\"+Inf\"", snapshot.count);
+        text.sample("fsl_latency_seconds_count", channel.labels, snapshot.count);
+        text.sample("fsl_latency_seconds_sum", channel.labels, snapshot.sum_ns / 1e9);
+    }
+    // ("quantile" is reserved for summaries, hence "percentile")
+    text.family("fsl_latency_percentile_seconds", "gauge", "Latency percentiles since start (histogram bucket upper bound)");
+    for (size_t c = 0; c < channels.size(); ++c)
+    {
+        static const std::pair<const char *, double> percentiles[] = {{"50", 0.5}, {"99", 0.99}, {"99.9", 0.999}};
+        for (const auto &percentile : percentiles)
+            text.sample("fsl_latency_percentile_seconds", channels[c].labels + ",percentile=\"" + percentile.first + "\"", snapshots[c].percentile(percentile.second) / 1e9);
+    }
+
+    text.family("fsl_uplink_unrouted", "counter", "Uplink datagrams with no UDS mapping for their opcode");
+    text.sample("fsl_uplink_unrouted_total", "", load(ul_unrouted_));
+    text.family("fsl_loop_wakeups", "counter", "Event loop wakeups (all loop threads)");
+    text.sample("fsl_loop_wakeups_total", "", load(loop_stats_.wakeups));
+
+    // Queues
+    text.family("fsl_ctrl_requests_queued", "counter", "Ctrl requests handed to the ctrl worker");
+    text.sample("fsl_ctrl_requests_queued_total", "", load(ctrl_queue_stats_.queued));
+    text.family("fsl_ctrl_requests_dropped", "counter", "Ctrl requests dropped on a full ctrl queue");
+    text.sample("fsl_ctrl_requests_dropped_total", "", load(ctrl_queue_stats_.dropped));
+    text.family("fsl_ctrl_queue_depth", "gauge", "Ctrl requests waiting for the ctrl worker");
+    text.sample("fsl_ctrl_queue_depth", "", static_cast<uint64_t>(ctrl_queue_.size()));
+    text.family("fsl_ctrl_queue_max_depth", "gauge", "Largest ctrl queue depth seen");
+    text.sample("fsl_ctrl_queue_max_depth", "", static_cast<uint64_t>(ctrl_queue_stats_.max_depth.load(std::memory_order_relaxed)));
+    text.family("fsl_egress_queued_bytes", "gauge", "Downlink bytes parked in the UDP egress queue (end of the last loop iteration)");
+    for (size_t s = 0; s < dl_shards_.size(); ++s)
+        text.sample("fsl_egress_queued_bytes", OpenMetricsText::labels({{"shard", std::to_string(s)}}), load(dl_shards_[s]->egress_queued_bytes));
+    text.family("fsl_egress_queued_datagrams", "gauge", "Downlink datagrams parked in the UDP egress queue (end of the last loop iteration)");
+    for (size_t s = 0; s < dl_shards_.size(); ++s)
+        text.sample("fsl_egress_queued_datagrams", OpenMetricsText::labels({{"shard", std::to_string(s)}}), load(dl_shards_[s]->egress_queued_datagrams));
+    text.family("fsl_buffer_pool_available", "gauge", "Free message buffers");
+    text.sample("fsl_buffer_pool_available", "", static_cast<uint64_t>(buffer_pool_.available()));
+    text.family("fsl_buffer_pool_capacity", "gauge", "Message buffers allocated at startup");
+    text.sample("fsl_buffer_pool_capacity", "", static_cast<uint64_t>(buffer_pool_.capacity()));
+    text.family("fsl_log_dropped_records", "counter", "Async log records dropped on a full ring");
+    text.sample("fsl_log_dropped_records_total", "", Logger::droppedRecords());
+
+    return text.finish();
+}
+
+void App::processPLMGCtrlRequest(const uint8_t *data, size_t length)
 {
     // Handle PLMG control request (FSL ctrl protocol)
     if (Logger::isDebugEnabled())
     {
-        Logger::debug("[CTRL] Processing PLMG control request, bytes=" + std::to_string(data.size()));
+        Logger::debug("[CTRL] Processing PLMG control request, bytes=" + std::to_string(length));
     }
 
-    if (data.size() < sizeof(FslCtrlGeneralRequest))
+    if (length < sizeof(FslCtrlGeneralRequest))
     {
         Logger::error("[CTRL] PLMG ctrl request too short");
         return;
     }
 
-    const FslCtrlGeneralRequest *req = reinterpret_cast<const FslCtrlGeneralRequest *>(data.data());
+    const FslCtrlGeneralRequest *req = reinterpret_cast<const FslCtrlGeneralRequest *>(data);
     FslCtrlOpcode opcode = req->header.ctrl_opcode;
     uint32_t seq_id = req->header.ctrl_seq_id;
 
@@ -589,6 +1480,8 @@ void App::processPLMGCtrlRequest(std::vector<uint8_t> &data)
     case FSL_CTRL_OP_SET_OPER:
     case FSL_CTRL_OP_SET_STANDBY:
     case FSL_CTRL_OP_GET_CBIT:
+    case FSL_CTRL_OP_SET_DL_RATE:
+    case FSL_CTRL_OP_GET_STATS:
         // Not allowed from PLMG, return error
         {
             FslCtrlGeneralResponse resp = {};
@@ -621,6 +1514,8 @@ void App::processPLMGCtrlRequest(std::vector<uint8_t> &data)
         ssize_t sent = it->second.response->send(response.data(), response.size());
         if (sent < 0)
         {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                ChannelCounters::add(it->second.counters->eagain, 1);
             Logger::error("[CTRL] Failed to send PLMG ctrl response");
         }
         else if (Logger::isDebugEnabled())
@@ -634,14 +1529,14 @@ void App::processPLMGCtrlRequest(std::vector<uint8_t> &data)
     }
 }
 
-void App::processELCtrlRequest(std::vector<uint8_t> &data)
+void App::processELCtrlRequest(const uint8_t *data, size_t length)
 {
     // Handle EL control request
     if (Logger::isDebugEnabled())
     {
-        Logger::debug("[CTRL] Processing EL control request, bytes=" + std::to_string(data.size()));
+        Logger::debug("[CTRL] Processing EL control request, bytes=" + std::to_string(length));
     }
-    const plmg_fcom_header *const hdr = static_cast<const plmg_fcom_header *>(static_cast<const void *>(data.data()));
+    const plmg_fcom_header *const hdr = static_cast<const plmg_fcom_header *>(static_cast<const void *>(data));
     if (Logger::isDebugEnabled())
     {
         Logger::debug("[CTRL] EL Header: opcode=" + std::to_string(hdr->opcode) +
@@ -651,149 +1546,100 @@ void App::processELCtrlRequest(std::vector<uint8_t> &data)
     // lilo:TODO: Implement EL control request handling
 }
 
-// --- Downlink message router ---
-// Returns number of bytes sent, or <0 on error
-int App::processDownlinkMessage(const std::string &server_name, std::vector<uint8_t> &data, uint32_t &msg_id_counter)
+// --- Downlink framing router ---
+// Dispatch on the framing resolved at startup: no string work per message
+// Returns offset of the payload in data, or <0 if the message is invalid
+int App::frameDownlink(size_t server_index, const uint8_t *data, size_t length, GslFslHeader &hdr, std::atomic<uint32_t> &msg_id_counter)
 {
-    if (server_name == "FSW_HIGH_DL" || server_name == "FSW_LOW_DL")
-        return processFSWDownlink(data, msg_id_counter);
-
-    if (server_name == "DL_PLMG_H" || server_name == "DL_PLMG_L")
-        return processPLMGDownlink(data, msg_id_counter);
-
-    if (server_name == "DL_EL_H" || server_name == "DL_EL_L")
-        return processELDownlink(data, msg_id_counter);
-
+    const char *label = config_.uds_servers[server_index].name.c_str();
+    switch (dl_framing_[server_index])
+    {
+    case DL_FRAMING_RAW:
+        return frameRawDownlink(label, data, length, hdr, msg_id_counter);
+    case DL_FRAMING_DATALINK:
+        return frameDatalinkDownlink(label, data, length, hdr, msg_id_counter);
+    }
     return -1;
 }
 
-// --- Downlink handlers ---
-
-// Returns number of bytes sent, or <0 on error
-int App::processFSWDownlink(std::vector<uint8_t> &data, uint32_t &msg_id_counter)
+// The header and the payload go out as two iovec segments: the payload is never copied
+int App::stageDownlink(DownlinkShard &shard, const uint8_t *payload, const GslFslHeader &hdr, const UdpEgress::DatagramTag &tag)
 {
-    if (Logger::isDebugEnabled())
-    {
-        Logger::debug("[DOWNLINK] FSW: opcode=0, sensor_id=" + std::to_string(config_.sensor_id) + ", payload_size=" + std::to_string(data.size()));
-    }
-
-    // FSW: no header, just payload
-    char buffer[DL_MTU];
-
-    GslFslHeader hdr;
-    hdr.opcode = 0; // No opcode for FSW downlink
-    hdr.sensor_id = config_.sensor_id;
-    hdr.length = data.size();
-    hdr.seq_id = msg_id_counter++;
-
-    if (GSL_FSL_HEADER_SIZE + data.size() > sizeof(buffer))
-    {
-        Logger::error("FSW downlink: buffer overflow risk, data too large");
-        return -1;
-    }
-
-    memcpy(buffer, &hdr, GSL_FSL_HEADER_SIZE);
-    memcpy(buffer + GSL_FSL_HEADER_SIZE, data.data(), data.size());
-    return udp_send_with_retry(buffer, data.size() + GSL_FSL_HEADER_SIZE);
+    DownlinkStage &stage = shard.stage;
+    if (stage.count == stage.msgs.size())
+        flushDownlink(shard);
+
+    size_t k = stage.count++;
+    stage.headers[k] = hdr;
+    stage.tags[k] = tag;
+    iovec &payload_iov = stage.iovecs[2 * k + 1];
+    payload_iov.iov_base = const_cast<uint8_t *>(payload);
+    payload_iov.iov_len = hdr.length;
+    return static_cast<int>(GSL_FSL_HEADER_SIZE + hdr.length);
 }
 
-// Returns number of bytes sent, or <0 on error
-int App::processPLMGDownlink(std::vector<uint8_t> &data, uint32_t &msg_id_counter)
+size_t App::flushDownlink(DownlinkShard &shard)
 {
-    const fcom_datalink_header *const hdr_in = static_cast<const fcom_datalink_header *>(static_cast<const void *>(data.data()));
-
-    if (Logger::isDebugEnabled())
-    {
-        Logger::debug("[DOWNLINK] PLMG: opcode=" + std::to_string(hdr_in->opcode) + ", sensor_id=" + std::to_string(config_.sensor_id) + ", payload_size=" + std::to_string(data.size() - FCOM_DATALINK_HEADER_SIZE));
-    }
-
-    // PLMG: header + payload, header is fcom_datalink_header
-    if (data.size() < FCOM_DATALINK_HEADER_SIZE)
+    DownlinkStage &stage = shard.stage;
+    if (stage.count == 0)
+        return 0;
+
+    // The queue overflowed if send() rejected datagrams or (drop_oldest) evicted parked ones
+    uint64_t queue_drops = shard.egress->dropped();
+    size_t accepted = shard.egress->send(stage.msgs.data(), stage.count, stage.tags.data());
+    size_t dropped = stage.count - accepted;
+    queue_drops = shard.egress->dropped() - queue_drops;
+    if (queue_drops > 0)
     {
-        Logger::error("PLMG downlink too short for header");
-        return -1;
+        shard.queue_full_drops->report(0, queue_drops);
     }
+    stage.count = 0;
+    return dropped;
+}
 
-    uint16_t opcode = hdr_in->opcode;
-    const uint8_t *payload = data.data() + FCOM_DATALINK_HEADER_SIZE;
-    size_t payload_len = data.size() - FCOM_DATALINK_HEADER_SIZE;
-
-    char buffer[DL_MTU];
+// --- Downlink framing ---
 
-    GslFslHeader hdr;
-    hdr.opcode = opcode;
-    hdr.sensor_id = config_.sensor_id;
-    hdr.length = payload_len;
-    hdr.seq_id = msg_id_counter++;
+// Raw (FSW): no header, the whole message is payload
+int App::frameRawDownlink(const char *label, const uint8_t * /*data*/, size_t length, GslFslHeader &hdr, std::atomic<uint32_t> &msg_id_counter)
+{
+    FSL_LOG_DEBUG("[DOWNLINK] %s: opcode=0, sensor_id=%d, payload_size=%zu", label, config_.sensor_id, length);
 
-    if (GSL_FSL_HEADER_SIZE + payload_len > sizeof(buffer))
+    if (GSL_FSL_HEADER_SIZE + length > DL_MTU)
     {
-        Logger::error("PLMG downlink: buffer overflow risk, payload too large");
+        FSL_LOG_ERROR("%s downlink: buffer overflow risk, data too large", label);
         return -1;
     }
 
-    memcpy(buffer, &hdr, GSL_FSL_HEADER_SIZE);
-    memcpy(buffer + GSL_FSL_HEADER_SIZE, payload, payload_len);
-    return udp_send_with_retry(buffer, payload_len + GSL_FSL_HEADER_SIZE);
+    hdr.opcode = 0; // No opcode for raw downlink
+    hdr.sensor_id = config_.sensor_id;
+    hdr.length = length;
+    hdr.seq_id = msg_id_counter.fetch_add(1, std::memory_order_relaxed);
+    return 0;
 }
 
-// Returns number of bytes sent, or <0 on error
-int App::processELDownlink(std::vector<uint8_t> &data, uint32_t &msg_id_counter)
+// Datalink (PLMG, EL): header + payload, header is fcom_datalink_header
+int App::frameDatalinkDownlink(const char *label, const uint8_t *data, size_t length, GslFslHeader &hdr, std::atomic<uint32_t> &msg_id_counter)
 {
-    const fcom_datalink_header *const hdr_in = static_cast<const fcom_datalink_header *>(static_cast<const void *>(data.data()));
-
-    if (Logger::isDebugEnabled())
+    if (length < FCOM_DATALINK_HEADER_SIZE)
     {
-        Logger::debug("[DOWNLINK] EL: opcode=" + std::to_string(hdr_in->opcode) + ", sensor_id=" + std::to_string(config_.sensor_id) + ", payload_size=" + std::to_string(data.size() - FCOM_DATALINK_HEADER_SIZE));
-    }
-
-    // EL: header + payload, header is fcom_datalink_header
-    if (data.size() < FCOM_DATALINK_HEADER_SIZE)
-    {
-        Logger::error("EL downlink too short for header");
+        FSL_LOG_ERROR("%s downlink too short for header", label);
         return -1;
     }
 
-    uint16_t opcode = hdr_in->opcode;
-    const uint8_t *payload = data.data() + FCOM_DATALINK_HEADER_SIZE;
-    size_t payload_len = data.size() - FCOM_DATALINK_HEADER_SIZE;
+    const fcom_datalink_header *const hdr_in = static_cast<const fcom_datalink_header *>(static_cast<const void *>(data));
+    size_t payload_len = length - FCOM_DATALINK_HEADER_SIZE;
 
-    char buffer[DL_MTU];
+    FSL_LOG_DEBUG("[DOWNLINK] %s: opcode=%u, sensor_id=%d, payload_size=%zu", label, static_cast<unsigned>(hdr_in->opcode), config_.sensor_id, payload_len);
 
-    GslFslHeader hdr;
-    hdr.opcode = opcode;
-    hdr.sensor_id = config_.sensor_id;
-    hdr.length = payload_len;
-    hdr.seq_id = msg_id_counter++;
-
-    if (GSL_FSL_HEADER_SIZE + payload_len > sizeof(buffer))
+    if (GSL_FSL_HEADER_SIZE + payload_len > DL_MTU)
     {
-        Logger::error("EL downlink: buffer overflow risk, payload too large");
+        FSL_LOG_ERROR("%s downlink: buffer overflow risk, payload too large", label);
         return -1;
     }
 
-    memcpy(buffer, &hdr, GSL_FSL_HEADER_SIZE);
-    memcpy(buffer + GSL_FSL_HEADER_SIZE, payload, payload_len);
-    return udp_send_with_retry(buffer, payload_len + GSL_FSL_HEADER_SIZE);
-}
-
-// Helper: Retry UDP send N times with 100ms delay on failure (App private member)
-int App::udp_send_with_retry(const void *buffer, size_t len, int max_retries)
-{
-    for (int attempt = 0; attempt < max_retries; ++attempt)
-    {
-        int ret = udp_.send(buffer, len);
-        if (ret >= 0)
-            return ret;
-
-        // Add 1ms sleep between attempts to reduce burstiness
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        if (attempt < max_retries - 1)
-        {
-            // Optionally, keep the original 100ms sleep for longer retries if needed
-            // std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-    }
-    Logger::error("UDP send failed after retries");
-    return -1;
+    hdr.opcode = hdr_in->opcode;
+    hdr.sensor_id = config_.sensor_id;
+    hdr.length = payload_len;
+    hdr.seq_id = msg_id_counter.fetch_add(1, std::memory_order_relaxed);
+    return FCOM_DATALINK_HEADER_SIZE;
 }
@@ -4,6 +4,7 @@ friend struct AppTestFriend;
 #endif
 // app.h - Main FSL Application class
 #include <vector>
+#include <atomic>
 #include <string>
 #include <cstdint>
 #include <map>
@@ -11,11 +12,18 @@ friend struct AppTestFriend;
 #include "config.h"
 #include "uds.h"
 #include "udp.h"
-#include <queue>
-#include <mutex>
-#include <condition_variable>
+#include "msg_batch.h"
+#include "buffer_pool.h"
+#include "udp_egress.h"
+#include "event_loop.h"
+#include "mpsc_queue.h"
+#include "error_throttle.h"
+#include "channel_counters.h"
+#include "latency_histogram.h"
+#include "metrics_server.h"
 #include <csignal>   // For sig_atomic_t
 #include "icd/fsl.h" // For FslStates, FslCtrl* types
+#include "icd/fcom.h" // For DL_MTU, UL_MTU
 
 //
 // The App class manages UDP and multiple UDS sockets (server/client) for routing
@@ -30,28 +38,57 @@ friend struct AppTestFriend;
 //
 // Main methods:
 //   - App(const std::string &config_path): Constructor, loads config and sets up sockets
-//   - run(): Main event loop for polling and routing
+//   - run(): Main event loop for polling and routing (poll/epoll, or io_uring in app_uring.cpp)
 //   - cleanup(): Closes sockets and unlinks UDS files
 //   - signalHandler(int): Handles SIGINT/SIGTERM for graceful shutdown
 
 // CtrlRequest: Control/status message for FSL ctrl queue
 struct CtrlRequest
 {
-    std::string ctrl_uds_name; // Name of ctrl/status UDS channel
-    std::vector<uint8_t> data; // Raw message data
+    const char *ctrl_uds_name = ""; // Name of ctrl/status UDS channel (configured name, not copied)
+    PoolBuffer data;                // Raw message data (pool buffer, length() bytes)
+    int64_t receive_ns = 0;         // Receive time (CLOCK_REALTIME), 0 = unknown
+    LatencyHistogram *latency = nullptr; // Channel's receive-to-processed latency
 };
 
 class App
 {
 public:
-    static constexpr size_t CTRL_QUEUE_MAX_SIZE = 32;
-    std::queue<CtrlRequest> ctrl_queue_;
-    std::mutex ctrl_queue_mutex_;
-    std::condition_variable ctrl_queue_cv_;
+    // Default capacity of the ctrl request queue (<ctrl_status_uds queue_size>) and its limit
+    static constexpr size_t CTRL_QUEUE_MAX_SIZE = DEFAULT_CTRL_QUEUE_SIZE;
+    static constexpr int CTRL_QUEUE_LIMIT = 4096;
+    // Largest async logging ring (records per thread)
+    static constexpr int LOG_RING_RECORDS_LIMIT = 65536;
+    // Size of every pool buffer: one datagram of either direction, or one UDP GRO train
+    static constexpr size_t POOL_BUFFER_SIZE = 65536;
+    // Message buffers for every receive path, sized at startup (see bufferPoolCapacity())
+    // Declared first so it outlives every handle held by the members below
+    BufferPool buffer_pool_;
+    // Ctrl requests: event loop threads push, the ctrl worker pops (lock-free, preallocated)
+    MpscQueue<CtrlRequest> ctrl_queue_;
+    // Written after every push (and at shutdown) to wake the ctrl worker
+    // (created last in the constructor, so a throwing constructor leaves nothing to close)
+    int ctrl_queue_event_fd_ = -1;
 
     // Constructor: Loads config and sets up sockets
     App(const AppConfig &config);
 
+    // Destructor: closes the ctrl queue eventfd
+    ~App();
+
+    // Queue a ctrl request for the worker thread and wake it
+    // Returns false (request dropped) if the queue is full
+    bool enqueueCtrlRequest(CtrlRequest &&req);
+
+    // Ctrl queue counters, logged at shutdown
+    struct CtrlQueueStats
+    {
+        std::atomic<uint64_t> queued{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<size_t> max_depth{0};
+    };
+    const CtrlQueueStats &ctrlQueueStats() const { return ctrl_queue_stats_; }
+
     // Main event loop for polling and routing
     void run();
 
@@ -65,44 +102,215 @@ public:
     void processCtrlRequest(const CtrlRequest &req);
 
     // Process FSW control request
-    void processFSWCtrlRequest(std::vector<uint8_t> &data);
+    void processFSWCtrlRequest(const uint8_t *data, size_t length);
 
     // Process PLMG control request
-    void processPLMGCtrlRequest(std::vector<uint8_t> &data);
+    void processPLMGCtrlRequest(const uint8_t *data, size_t length);
 
     // Process EL control request
-    void processELCtrlRequest(std::vector<uint8_t> &data);
+    void processELCtrlRequest(const uint8_t *data, size_t length);
+
+    // GET_STATS response (FslCtrlGetStatsResponse + one FslStatsRecord per channel), read from
+    // the lock-free channel counters while the loops keep running
+    std::vector<uint8_t> buildStatsResponse(uint32_t seq_id) const;
+
+    // OpenMetrics text of the channel counters, queue depths and loop counters (served by
+    // the metrics endpoint thread; reads atomics only)
+    std::string renderMetrics() const;
 
-    // Process a downlink message for a given server
-    int processDownlinkMessage(const std::string &server_name, std::vector<uint8_t> &data, uint32_t &msg_id_counter);
+    // Number of pool buffers config needs: uplink and downlink receive batches, io_uring
+    // buffer rings, and every ctrl request that can be queued, processed or received at once
+    static size_t bufferPoolCapacity(const AppConfig &config);
 
-    // Process FSW downlink message
-    int processFSWDownlink(std::vector<uint8_t> &data, uint32_t &msg_id_counter);
+    // Route a batch of uplink datagrams (GSL-FSL framed) to their UDS clients
+    // Datagrams coalesced by UDP GRO are split back into frames by segment size
+    void routeUplinkBatch(MsgBatch &batch);
 
-    // Process PLMG downlink message
-    int processPLMGDownlink(std::vector<uint8_t> &data, uint32_t &msg_id_counter);
+    // Maximum <event_loop><downlink_shards>
+    static constexpr int MAX_DOWNLINK_SHARDS = 16;
 
-    // Process EL downlink message
-    int processELDownlink(std::vector<uint8_t> &data, uint32_t &msg_id_counter);
+    // Downlink scheduling: <server priority> range, <server weight> range, datagrams per
+    // weight unit granted each deficit round robin round, and rounds per loop wakeup
+    static constexpr int MAX_DOWNLINK_PRIORITY = 15;
+    static constexpr int MAX_DOWNLINK_WEIGHT = 100;
+    static constexpr int DRR_QUANTUM_DATAGRAMS = DEFAULT_UDS_BATCH_SIZE;
+    static constexpr int DRR_ROUNDS_PER_WAKEUP = 4;
+
+    // Build the GSL-FSL header for a downlink message from UDS server index, with the framing
+    // resolved for that server at startup
+    // Returns offset of the payload in data, or <0 if the message is invalid
+    int frameDownlink(size_t server_index, const uint8_t *data, size_t length, GslFslHeader &hdr, std::atomic<uint32_t> &msg_id_counter);
+
+protected:
+    // One downlink loop thread's servers, UDP socket and egress (defined below)
+    struct DownlinkShard;
+
+    // Readiness event loop (poll/epoll), single thread or split uplink/downlink threads
+    void runReadinessLoop();
+    // io_uring event loop (app_uring.cpp); returns false if io_uring is unavailable
+    bool runUringLoop();
 
 private:
-    // Helper: Retry UDP send N times with 100ms delay on failure
-    int udp_send_with_retry(const void *buffer, size_t len, int max_retries = 100);
+    // Channels served by one readiness loop thread
+    enum LoopChannels : uint32_t
+    {
+        LOOP_UPLINK = 1u << 0,   // UDP receive, ctrl requests
+        LOOP_DOWNLINK = 1u << 1, // UDS servers, UDP egress
+    };
+    // Serve channels (LoopChannels) until shutdown; shard is the downlink shard served with
+    // LOOP_DOWNLINK, role is for logging
+    void serveChannels(EventLoopBackend backend, uint32_t channels, DownlinkShard &shard, const std::string &role);
+    // Log per-backend loop counters at shutdown
+    void logLoopStats(const char *backend) const;
+    // Stop the ctrl worker thread (wakes it through the eventfd) and join it
+    void stopCtrlWorker();
+    // Apply a <realtime> thread profile to the calling thread (errors are logged, not fatal)
+    void applyRealtimeProfile(const ThreadProfileConfig &profile, const std::string &thread_name);
+
+    // Event loop handlers (one per channel)
+    void onUdpEvent(DownlinkShard &shard, uint32_t events);
+    // Receive up to max_count datagrams from UDS server index and stage them for the UDP egress
+    // Returns number of datagrams received, or -1 on error
+    int receiveDownlink(size_t index, size_t max_count);
+    void onCtrlRequestReadable(const std::string &ctrl_uds_name);
+
+    // Downlink framing per message format (header built into hdr, returns payload offset);
+    // label names the source in log messages
+    int frameRawDownlink(const char *label, const uint8_t *data, size_t length, GslFslHeader &hdr, std::atomic<uint32_t> &msg_id_counter);
+    int frameDatalinkDownlink(const char *label, const uint8_t *data, size_t length, GslFslHeader &hdr, std::atomic<uint32_t> &msg_id_counter);
+    // Stage header + payload segments on a shard until flushDownlink(shard); tag carries the
+    // server index and receive time to the egress sent hook (id NO_TAG: not measured)
+    int stageDownlink(DownlinkShard &shard, const uint8_t *payload, const GslFslHeader &hdr, const UdpEgress::DatagramTag &tag);
+    // Returns number of staged datagrams dropped (egress queue full)
+    size_t flushDownlink(DownlinkShard &shard);
 
 protected:
     AppConfig config_;
     UdpServerSocket udp_;
+    // Uplink: preallocated recvmmsg buffers for the UDP socket
+    MsgBatch ul_batch_;
+    // Downlink: datagrams waiting for flushDownlink(), two segments each
+    // (GSL-FSL header from headers[i], payload straight from the receive buffer)
+    struct DownlinkStage
+    {
+        std::vector<GslFslHeader> headers;
+        std::vector<iovec> iovecs;
+        std::vector<mmsghdr> msgs;
+        std::vector<UdpEgress::DatagramTag> tags; // server index and receive time
+        size_t count = 0;
+    };
+    // Downlink shard: the UDS servers one loop thread drains and the UDP socket they go out on
+    struct DownlinkShard
+    {
+        UdpServerSocket *udp = nullptr;          // udp_ for shard 0, own_udp otherwise
+        std::unique_ptr<UdpServerSocket> own_udp; // ephemeral port, connected to the GSL endpoint
+        // Egress stage: batches datagrams per loop iteration into sendmmsg()
+        std::unique_ptr<UdpEgress> egress;
+        DownlinkStage stage;
+        // Servers sorted by priority (highest first), config order within a level
+        struct Server
+        {
+            size_t index;        // into uds_servers_
+            int priority;
+            int weight;
+            int64_t deficit = 0; // datagrams this server may still take in the current round
+            bool ready = false;  // reported readable and not drained yet
+        };
+        std::vector<Server> servers;
+        bool low_paused = false; // lower priority servers unwatched while the egress is backlogged
+        // Datagrams dropped on a full egress queue (rate-limited report)
+        std::unique_ptr<ErrorThrottle> queue_full_drops;
+        // Egress queue depth published by the shard's loop every iteration (metrics endpoint)
+        std::atomic<uint64_t> egress_queued_bytes{0};
+        std::atomic<uint64_t> egress_queued_datagrams{0};
+        // Backlogged: parked on a full socket buffer or waiting for shaper tokens
+        bool backlogged() const { return egress->wantsWritable() || egress->throttled(); }
+    };
+    // Downlink shaper: one token bucket for the GSL link, shared by every shard's egress
+    // (rate changed at runtime by FSL_CTRL_OP_SET_DL_RATE)
+    TokenBucket dl_shaper_;
+    // Set while runUringLoop() serves the channels: its sends are not shaped, so
+    // FSL_CTRL_OP_SET_DL_RATE is refused (read by the ctrl worker thread)
+    std::atomic<bool> uring_active_{false};
+    std::vector<std::unique_ptr<DownlinkShard>> dl_shards_;
+    // Drain the shard's ready servers: strict priority between levels, deficit round robin
+    // (by weight) within a level; lower levels wait while the egress is backlogged
+    void scheduleDownlink(DownlinkShard &shard);
+    // Downlink: GSL-FSL seq_id generator (shared by downlink threads)
+    std::atomic<uint32_t> dl_seq_id_{1};
     std::vector<std::unique_ptr<UdsSocket>> uds_servers_;
+    // Traffic counters of each UDS server (same index as uds_servers_)
+    std::unique_ptr<ChannelCounters[]> dl_counters_;
+    // UDS receive to UDP send latency of each UDS server (same index as uds_servers_)
+    std::unique_ptr<LatencyHistogram[]> dl_latency_;
+    // Downlink message format of each UDS server (same index as uds_servers_, from <server framing>)
+    enum DownlinkFraming : uint8_t
+    {
+        DL_FRAMING_RAW,      // whole message is payload (FSW)
+        DL_FRAMING_DATALINK, // fcom_datalink_header + payload (PLMG, EL)
+    };
+    std::vector<DownlinkFraming> dl_framing_;
+    // Preallocated recvmmsg buffers, one batch per UDS server (same index as uds_servers_)
+    std::vector<std::unique_ptr<MsgBatch>> uds_server_batches_;
     std::map<std::string, std::unique_ptr<UdsSocket>> uds_clients_;
+    struct UplinkRoute;
+    // Uplink: per-client sendmmsg staging so each batch costs one send per destination
+    struct UplinkSendGroup
+    {
+        std::string name; // UDS client name
+        UdsSocket *client = nullptr;
+        std::vector<iovec> iovecs;
+        std::vector<mmsghdr> msgs;
+        std::vector<UplinkRoute *> routes; // route of each staged datagram (drops are counted per route)
+        std::vector<int64_t> receive_ns;   // receive time of each staged datagram (0 = unknown)
+        size_t count = 0;
+        // Datagrams the client did not take (rate-limited report; the socket reports the errno)
+        std::unique_ptr<ErrorThrottle> send_drops;
+    };
+    std::map<std::string, UplinkSendGroup> ul_send_groups_;
+    // Uplink route: one per <ul_uds_mapping> entry, with its own counters on its own cache line
+    struct UplinkRoute
+    {
+        uint16_t opcode = 0;
+        UplinkSendGroup *group = nullptr;
+        ChannelCounters counters;
+        LatencyHistogram latency; // UDP receive to UDS send
+    };
+    std::vector<std::unique_ptr<UplinkRoute>> ul_routes_;
+    // Uplink routing table compiled from the config: GslFslHeader::opcode -> route (nullptr =
+    // unmapped), so routing a datagram is one indexed load
+    std::unique_ptr<UplinkRoute *[]> ul_route_table_;
+    std::atomic<uint64_t> ul_unrouted_{0};
+    ErrorThrottle ul_unrouted_errors_{"No UDS mapping for uplink datagram"};
+    // Uplink staging: stageUplink() references the payload, flushUplink() sends all groups
+    // receive_ns: receive time for the route's latency histogram (0 = not measured)
+    void stageUplink(uint8_t *data, size_t n, bool truncated = false, int64_t receive_ns = 0);
+    void flushUplink();
+    void flushUplinkGroup(UplinkSendGroup &group);
+    // Event loop counters, logged at shutdown to compare backends (updated by every loop thread)
+    struct LoopStats
+    {
+        std::atomic<uint64_t> wakeups{0};
+        std::atomic<uint64_t> dl_datagrams{0};
+        std::atomic<uint64_t> ul_datagrams{0};
+    };
+    LoopStats loop_stats_;
+    CtrlQueueStats ctrl_queue_stats_;
     struct CtrlUdsSockets
     {
         std::unique_ptr<UdsSocket> request;
         std::unique_ptr<UdsSocket> response;
+        // Requests received on this channel (eagain: responses the app did not take)
+        std::unique_ptr<ChannelCounters> counters{new ChannelCounters()};
+        // Request receive to processed (response sent) latency
+        std::unique_ptr<LatencyHistogram> latency{new LatencyHistogram()};
         // Flag for graceful shutdown (set by signal handler)
         static volatile std::sig_atomic_t shutdown_flag_;
     };
     std::map<std::string, CtrlUdsSockets> ctrl_uds_sockets_;
     static volatile sig_atomic_t shutdown_flag_;
+    // Signalled by signalHandler() to wake every event loop thread
+    static int shutdown_event_fd_;
 
     // CBIT state for FSL (for PLMG ctrl requests)
     FslStates cbit_state_ = FSL_STATE_STANDBY;
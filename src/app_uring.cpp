@@ -0,0 +1,381 @@
+// app_uring.cpp - io_uring event loop for the FSL Application
+//
+// App::runUringLoop() is the completion-based alternative to the poll/epoll loop
+// (<event_loop><backend>io_uring</backend>). All I/O is submitted from the run() thread:
+//   - Downlink: one multishot recv per UDS server, fed from a shared provided buffer
+//     ring. Each completion is framed by the same frame*Downlink() handlers as the
+//     readiness loop and sent with IORING_OP_SENDMSG as two iovecs: the GSL-FSL header
+//     and the payload still sitting in the receive buffer. The buffer is handed back
+//     to the ring when the send completes.
+//   - Uplink: one multishot recv on the UDP socket with its own buffer ring; datagrams
+//     are routed with stageUplink()/flushUplink() and the buffers recycled at the end
+//     of the iteration.
+//   - Ctrl requests: one-shot POLL_ADD per request socket, re-armed after each read.
+//   - Shutdown: one POLL_ADD on the shutdown eventfd, so a signal delivered to another
+//     thread still ends the wait in io_uring_enter().
+//
+// Downlink sends are transmitted as linked chains (IOSQE_IO_LINK) and only one chain
+// is in flight at a time, so datagrams leave in seq_id order; whatever is received
+// while a chain is in flight goes out as the next chain. New sends, re-arms and the
+// wait for the next completions share a single io_uring_enter() per iteration.
+//
+// The sockets driven by the ring are switched to blocking mode, so a full socket
+// buffer makes the kernel wait for space instead of failing the request. Back-pressure
+// reaches the UDS writers when all downlink buffers are held: the multishot receives
+// stop with ENOBUFS and are re-armed once sends complete.
+//
+// Multishot receives carry no ancillary data, so latencies start when the receive
+// completion is processed rather than at the kernel receive timestamp.
+//
+// If io_uring cannot be set up (kernel older than 6.0, or a build without io_uring
+// headers), runUringLoop() returns false before touching any socket and run() falls
+// back to the epoll loop.
+
+#include "app.h"
+#include "uring.h"
+#include "logger.h"
+#include "icd/fsl.h"
+#include "icd/fcom.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+
+#ifdef FSL_HAVE_IO_URING
+
+namespace
+{
+// user_data: operation in the high 32 bits, channel index or buffer id in the low 32 bits
+enum UringOp : uint32_t
+{
+    URING_DL_RECV = 1,   // index: UDS server
+    URING_UL_RECV = 2,   // index: unused
+    URING_DL_SEND = 3,   // index: downlink buffer id
+    URING_CTRL_POLL = 4, // index: ctrl request channel
+    URING_SHUTDOWN = 5,  // index: unused
+};
+
+constexpr uint16_t DL_BUFFER_GROUP = 0;
+constexpr uint16_t UL_BUFFER_GROUP = 1;
+
+// Max wait for the downlink chain in flight at shutdown
+constexpr int SHUTDOWN_DRAIN_MS = 500;
+
+uint64_t userData(UringOp op, uint32_t index)
+{
+    return (static_cast<uint64_t>(op) << 32) | index;
+}
+
+// Downlink send state for one receive buffer (indexed by buffer id)
+struct DownlinkSend
+{
+    GslFslHeader hdr;
+    iovec iov[2];
+    msghdr msg;
+    uint32_t server; // UDS server index (failed sends are counted on it)
+    int64_t receive_ns; // completion time of the receive (latency start)
+};
+
+bool setBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) == 0;
+}
+} // namespace
+
+bool App::runUringLoop()
+{
+    std::unique_ptr<IoUring> ring;
+    std::unique_ptr<IoUringBufferRing> dl_buffers;
+    std::unique_ptr<IoUringBufferRing> ul_buffers;
+    try
+    {
+        ring.reset(new IoUring(config_.event_loop_uring_entries));
+        dl_buffers.reset(new IoUringBufferRing(*ring, DL_BUFFER_GROUP, config_.event_loop_uring_buffers, buffer_pool_, DL_MTU));
+        ul_buffers.reset(new IoUringBufferRing(*ring, UL_BUFFER_GROUP, config_.event_loop_uring_buffers, buffer_pool_, UL_MTU));
+    }
+    catch (const std::exception &e)
+    {
+        Logger::error(std::string("io_uring backend unavailable (") + e.what() + "), falling back to epoll");
+        return false;
+    }
+
+    const int udp_fd = udp_.getFd();
+    setBlocking(udp_fd);
+    for (const auto &server : uds_servers_)
+        setBlocking(server->getFd());
+
+    std::vector<std::string> ctrl_names;
+    std::vector<int> ctrl_fds;
+    for (const auto &entry : ctrl_uds_sockets_)
+    {
+        if (!entry.second.request)
+            continue;
+        ctrl_names.push_back(entry.first);
+        ctrl_fds.push_back(entry.second.request->getFd());
+    }
+
+    std::vector<DownlinkSend> dl_sends(dl_buffers->count());
+    for (DownlinkSend &send : dl_sends)
+    {
+        memset(&send.msg, 0, sizeof(send.msg));
+        send.iov[0].iov_base = &send.hdr;
+        send.iov[0].iov_len = GSL_FSL_HEADER_SIZE;
+        send.msg.msg_name = const_cast<sockaddr_in *>(&udp_.getRemoteAddr());
+        send.msg.msg_namelen = sizeof(sockaddr_in);
+        send.msg.msg_iov = send.iov;
+        send.msg.msg_iovlen = 2;
+    }
+
+    std::vector<bool> dl_armed(uds_servers_.size(), false);
+    std::vector<bool> ctrl_armed(ctrl_fds.size(), false);
+    bool ul_armed = false;
+    // Re-arms queued per iteration never exceed this many SQEs
+    const unsigned rearm_reserve = static_cast<unsigned>(dl_armed.size() + ctrl_armed.size() + 1);
+
+    unsigned dl_held = 0;                // downlink buffers taken from the ring and not yet recycled
+    std::vector<uint16_t> dl_pending;    // framed downlink buffers waiting for the next chain
+    size_t dl_in_flight = 0;             // sends of the chain in flight
+    std::vector<uint16_t> ul_held;       // uplink buffers to recycle after flushUplink()
+    dl_pending.reserve(dl_buffers->count());
+    ul_held.reserve(ul_buffers->count());
+
+    uring_active_.store(true, std::memory_order_relaxed);
+    Logger::info("Event loop backend: io_uring, channels: " + std::to_string(1 + uds_servers_.size() + ctrl_fds.size()));
+    applyRealtimeProfile(config_.realtime_loop, "loop io_uring");
+    // Multishot recv carries no ancillary data, so a GRO train could not be split
+    if (config_.udp_gro)
+        Logger::info("UDP GRO is not used by the io_uring backend");
+    // Downlink sends bypass the shard egresses, one SQE per datagram
+    if (config_.udp_gso_max_segments > 1)
+        Logger::info("UDP GSO is not used by the io_uring backend");
+    // One ring, one issuer: uplink and downlink share this thread
+    if (config_.event_loop_threading == "split")
+        Logger::info("Split threading is not used by the io_uring backend");
+    if (config_.event_loop_downlink_shards > 1)
+        Logger::info("Downlink shards are not used by the io_uring backend");
+    // Multishot receives complete in kernel order: no per-server scheduling
+    for (const auto &server : config_.uds_servers)
+    {
+        if (server.priority != 0 || server.weight != 1)
+        {
+            Logger::info("Downlink priorities and weights are not used by the io_uring backend");
+            break;
+        }
+    }
+    // Sends are chained back to back: nothing paces them (SET_DL_RATE is refused meanwhile)
+    if (dl_shaper_.enabled())
+        Logger::info("Downlink rate limit is not used by the io_uring backend");
+
+    ErrorThrottle send_errors("io_uring downlink send failed");
+    ErrorThrottle send_cancels("io_uring downlink send cancelled (earlier send in chain failed)");
+    auto onDownlinkSent = [&](uint16_t bid, int res)
+    {
+        if (res >= 0)
+        {
+            loop_stats_.dl_datagrams.fetch_add(1, std::memory_order_relaxed);
+            dl_latency_[dl_sends[bid].server].record(LatencyHistogram::nowNs() - dl_sends[bid].receive_ns);
+        }
+        else if (res != -ECANCELED)
+        {
+            send_errors.report(-res);
+        }
+        else
+        {
+            send_cancels.report(0);
+        }
+        if (res < 0)
+        {
+            ChannelCounters &counters = dl_counters_[dl_sends[bid].server];
+            ChannelCounters::add(counters.drops, 1);
+            if (res == -EAGAIN)
+                ChannelCounters::add(counters.eagain, 1);
+        }
+        dl_buffers->recycle(bid);
+        --dl_held;
+        --dl_in_flight;
+    };
+
+    // Armed once: its completion ends the loop
+    bool shutdown_seen = false;
+    ring->prepPollAdd(shutdown_event_fd_, POLLIN, userData(URING_SHUTDOWN, 0));
+
+    while (!shutdown_flag_ && !shutdown_seen)
+    {
+        // --- Queue the next downlink chain (only one in flight keeps seq_id order) ---
+        if (dl_in_flight == 0 && !dl_pending.empty())
+        {
+            io_uring_sqe *prev = nullptr;
+            size_t queued = 0;
+            for (; queued < dl_pending.size() && ring->sqSpaceLeft() > rearm_reserve; ++queued)
+            {
+                uint16_t bid = dl_pending[queued];
+                io_uring_sqe *sqe = ring->prepSendMsg(udp_fd, &dl_sends[bid].msg, userData(URING_DL_SEND, bid));
+                if (prev)
+                    IoUring::linkNext(prev);
+                prev = sqe;
+            }
+            dl_in_flight = queued;
+            dl_pending.erase(dl_pending.begin(), dl_pending.begin() + queued);
+        }
+
+        // --- (Re-)arm receives and ctrl polls ---
+        if (dl_held < dl_buffers->count())
+        {
+            for (size_t i = 0; i < dl_armed.size(); ++i)
+            {
+                if (!dl_armed[i])
+                    dl_armed[i] = ring->prepRecvMultishot(uds_servers_[i]->getFd(), DL_BUFFER_GROUP, userData(URING_DL_RECV, i)) != nullptr;
+            }
+        }
+        if (!ul_armed)
+            ul_armed = ring->prepRecvMultishot(udp_fd, UL_BUFFER_GROUP, userData(URING_UL_RECV, 0)) != nullptr;
+        for (size_t i = 0; i < ctrl_armed.size(); ++i)
+        {
+            if (!ctrl_armed[i])
+                ctrl_armed[i] = ring->prepPollAdd(ctrl_fds[i], POLLIN, userData(URING_CTRL_POLL, i)) != nullptr;
+        }
+
+        // --- Submit everything queued above and wait for completions (one syscall) ---
+        if (ring->submitAndWait(true, -1) < 0)
+        {
+            Logger::error(std::string("io_uring_enter failed: ") + ::strerror(errno));
+            break;
+        }
+        loop_stats_.wakeups.fetch_add(1, std::memory_order_relaxed);
+
+        // --- Completions ---
+        io_uring_cqe *cqe;
+        while ((cqe = ring->peekCqe()) != nullptr)
+        {
+            const UringOp op = static_cast<UringOp>(cqe->user_data >> 32);
+            const uint32_t index = static_cast<uint32_t>(cqe->user_data);
+            const int res = cqe->res;
+            const uint32_t flags = cqe->flags;
+            ring->seenCqe();
+
+            switch (op)
+            {
+            case URING_DL_RECV:
+            {
+                if (!(flags & IORING_CQE_F_MORE))
+                    dl_armed[index] = false;
+                if (res < 0)
+                {
+                    // ENOBUFS: all downlink buffers held; re-armed once sends complete
+                    if (res != -ENOBUFS)
+                        FSL_LOG_ERROR("io_uring receive failed on UDS server index %zu: %s", static_cast<size_t>(index), strerror(-res));
+                    break;
+                }
+                if (!(flags & IORING_CQE_F_BUFFER))
+                    break;
+
+                uint16_t bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+                ++dl_held;
+                uint8_t *data = dl_buffers->buffer(bid);
+                DownlinkSend &send = dl_sends[bid];
+                send.server = index;
+                send.receive_ns = LatencyHistogram::nowNs();
+                ChannelCounters &counters = dl_counters_[index];
+                ChannelCounters::add(counters.datagrams, 1);
+                ChannelCounters::add(counters.bytes, res);
+                if (res == static_cast<int>(dl_buffers->bufferSize()))
+                    ChannelCounters::add(counters.truncated, 1); // filled the buffer: may have been cut
+                int offset = res > 0 ? frameDownlink(index, data, res, send.hdr, dl_seq_id_) : -1;
+                if (offset < 0)
+                {
+                    ChannelCounters::add(counters.drops, 1);
+                    if (res > 0)
+                        FSL_LOG_ERROR("Failed to send UDP packet from UDS server index %zu", static_cast<size_t>(index));
+                    dl_buffers->recycle(bid);
+                    --dl_held;
+                    break;
+                }
+                send.iov[1].iov_base = data + offset;
+                send.iov[1].iov_len = send.hdr.length;
+                dl_pending.push_back(bid);
+
+                FSL_LOG_DEBUG("Routed UDS->UDP: bytes=%zu, src='%s' (server: '%s')", static_cast<size_t>(send.hdr.length + GSL_FSL_HEADER_SIZE), uds_servers_[index]->getMyPath().c_str(), config_.uds_servers[index].name.c_str());
+                break;
+            }
+
+            case URING_DL_SEND:
+                onDownlinkSent(static_cast<uint16_t>(index), res);
+                break;
+
+            case URING_UL_RECV:
+            {
+                if (!(flags & IORING_CQE_F_MORE))
+                    ul_armed = false;
+                if (res < 0)
+                {
+                    if (res != -ENOBUFS)
+                        FSL_LOG_ERROR("io_uring receive failed on UDP socket: %s", strerror(-res));
+                    break;
+                }
+                if (!(flags & IORING_CQE_F_BUFFER))
+                    break;
+
+                uint16_t bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+                ul_held.push_back(bid);
+                stageUplink(ul_buffers->buffer(bid), res, false, LatencyHistogram::nowNs());
+                break;
+            }
+
+            case URING_CTRL_POLL:
+                ctrl_armed[index] = false;
+                if (res > 0)
+                    onCtrlRequestReadable(ctrl_names[index]);
+                else if (res < 0)
+                    Logger::error("io_uring poll failed on ctrl request socket '" + ctrl_names[index] + "': " + strerror(-res));
+                break;
+
+            case URING_SHUTDOWN:
+                shutdown_seen = true;
+                break;
+            }
+        }
+
+        // --- Uplink: one sendmmsg() per destination, then give the buffers back ---
+        flushUplink();
+        for (uint16_t bid : ul_held)
+            ul_buffers->recycle(bid);
+        ul_held.clear();
+    }
+
+    // Let the chain in flight complete so the kernel is done with its buffers
+    while (dl_in_flight > 0)
+    {
+        if (ring->submitAndWait(true, SHUTDOWN_DRAIN_MS) < 0)
+            break;
+        size_t before = dl_in_flight;
+        io_uring_cqe *cqe;
+        while ((cqe = ring->peekCqe()) != nullptr)
+        {
+            if (static_cast<UringOp>(cqe->user_data >> 32) == URING_DL_SEND)
+                onDownlinkSent(static_cast<uint16_t>(cqe->user_data), cqe->res);
+            ring->seenCqe();
+        }
+        if (dl_in_flight == before)
+            break;
+    }
+    if (!dl_pending.empty())
+        Logger::error("io_uring: " + std::to_string(dl_pending.size()) + " downlink datagram(s) not sent at shutdown");
+
+    logLoopStats("io_uring");
+    uring_active_.store(false, std::memory_order_relaxed);
+
+    // The ring goes first: buffer memory must outlive any request still referencing it
+    ring.reset();
+    return true;
+}
+
+#else // !FSL_HAVE_IO_URING
+
+bool App::runUringLoop()
+{
+    Logger::error("io_uring backend unavailable (not built with io_uring support), falling back to epoll");
+    return false;
+}
+
+#endif // FSL_HAVE_IO_URING
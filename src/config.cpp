@@ -9,7 +9,9 @@ using namespace tinyxml2;
 
 // override_config_from_env: Override config fields from environment variables if set
 // Priority: environment > config.xml
-// Supported env vars: FSL_SENSOR_ID, FSL_LOCAL_PORT, FSL_REMOTE_IP, FSL_REMOTE_PORT, LOGGING_LEVEL
+// Supported env vars: FSL_SENSOR_ID, FSL_LOCAL_PORT, FSL_REMOTE_IP, FSL_REMOTE_PORT, LOGGING_LEVEL,
+// FSL_LOOP_CPUS, FSL_LOOP_POLICY, FSL_LOOP_PRIORITY, FSL_CTRL_CPUS, FSL_CTRL_POLICY,
+// FSL_CTRL_PRIORITY, FSL_MLOCKALL, FSL_METRICS_UDS, FSL_METRICS_PORT
 void override_config_from_env(AppConfig &config)
 {
     if (const char *env = std::getenv("FSL_SENSOR_ID"))
@@ -40,6 +42,36 @@ void override_config_from_env(AppConfig &config)
             c = toupper(c);
         config.logging_level = lvl;
     }
+
+    // Real-time profile (deployment specific: CPU layout differs per flight computer)
+    auto override_profile = [](const char *prefix, ThreadProfileConfig &profile)
+    {
+        std::string name(prefix);
+        if (const char *env = std::getenv((name + "_CPUS").c_str()))
+            profile.cpus = env;
+        if (const char *env = std::getenv((name + "_POLICY").c_str()))
+            profile.policy = env;
+        if (const char *env = std::getenv((name + "_PRIORITY").c_str()))
+            profile.priority = std::atoi(env);
+    };
+    override_profile("FSL_LOOP", config.realtime_loop);
+    override_profile("FSL_CTRL", config.realtime_ctrl_worker);
+
+    if (const char *env = std::getenv("FSL_MLOCKALL"))
+    {
+        std::string value(env);
+        config.realtime_mlockall = (value == "1" || value == "true");
+    }
+
+    if (const char *env = std::getenv("FSL_METRICS_UDS"))
+    {
+        config.metrics_uds_path = env;
+    }
+
+    if (const char *env = std::getenv("FSL_METRICS_PORT"))
+    {
+        config.metrics_tcp_port = std::atoi(env);
+    }
 }
 
 // rewrite_uds_paths: Rewrite UDS paths to be unique per instance
@@ -82,6 +114,12 @@ void rewrite_uds_paths(AppConfig &config, int instance)
             ctrl_cfg.response_path = prefix + ctrl_cfg.response_path.substr(5);
         }
     }
+
+    // Metrics endpoint
+    if (!config.metrics_uds_path.empty() && config.metrics_uds_path.rfind("/tmp/", 0) == 0)
+    {
+        config.metrics_uds_path = prefix + config.metrics_uds_path.substr(5);
+    }
 }
 
 // load_config: Parse config.xml and return AppConfig
@@ -106,13 +144,86 @@ AppConfig load_config(const char *filename, int instance)
     AppConfig config;
 
     // --- Parse Logging Level ---
-    // <logging><level>INFO|DEBUG|ERROR</level></logging>
+    // <logging><level>INFO|DEBUG|ERROR</level><async ring_records="256">false</async></logging>
     XMLElement *logging_node = root->FirstChildElement("logging");
     if (logging_node)
     {
         XMLElement *level_node = logging_node->FirstChildElement("level");
         if (level_node && level_node->GetText())
             config.logging_level = level_node->GetText();
+        XMLElement *async_node = logging_node->FirstChildElement("async");
+        if (async_node)
+        {
+            async_node->QueryBoolText(&config.logging_async);
+            async_node->QueryIntAttribute("ring_records", &config.logging_async_ring_records);
+        }
+    }
+
+    // --- Parse Metrics Endpoint ---
+    // <metrics><uds>/tmp/fsl_metrics</uds><tcp_port>0</tcp_port></metrics>
+    XMLElement *metrics_node = root->FirstChildElement("metrics");
+    if (metrics_node)
+    {
+        XMLElement *uds_node = metrics_node->FirstChildElement("uds");
+        if (uds_node && uds_node->GetText())
+            config.metrics_uds_path = uds_node->GetText();
+        XMLElement *port_node = metrics_node->FirstChildElement("tcp_port");
+        if (port_node)
+            port_node->QueryIntText(&config.metrics_tcp_port);
+    }
+
+    // --- Parse Event Loop Settings ---
+    // <event_loop><backend>poll|epoll|io_uring</backend><threading>single|split</threading><downlink_shards>..</downlink_shards><uring_entries>..</uring_entries><uring_buffers>..</uring_buffers></event_loop>
+    XMLElement *event_loop_node = root->FirstChildElement("event_loop");
+    if (event_loop_node)
+    {
+        XMLElement *backend_node = event_loop_node->FirstChildElement("backend");
+        if (backend_node && backend_node->GetText())
+            config.event_loop_backend = backend_node->GetText();
+        XMLElement *threading_node = event_loop_node->FirstChildElement("threading");
+        if (threading_node && threading_node->GetText())
+            config.event_loop_threading = threading_node->GetText();
+        XMLElement *shards_node = event_loop_node->FirstChildElement("downlink_shards");
+        if (shards_node)
+            shards_node->QueryIntText(&config.event_loop_downlink_shards);
+        XMLElement *entries_node = event_loop_node->FirstChildElement("uring_entries");
+        if (entries_node)
+            entries_node->QueryIntText(&config.event_loop_uring_entries);
+        XMLElement *buffers_node = event_loop_node->FirstChildElement("uring_buffers");
+        if (buffers_node)
+            buffers_node->QueryIntText(&config.event_loop_uring_buffers);
+    }
+
+    // --- Parse Buffer Pool Settings ---
+    // <buffer_pool><huge_pages>true|false</huge_pages></buffer_pool>
+    XMLElement *buffer_pool_node = root->FirstChildElement("buffer_pool");
+    if (buffer_pool_node)
+    {
+        XMLElement *huge_pages_node = buffer_pool_node->FirstChildElement("huge_pages");
+        if (huge_pages_node)
+            huge_pages_node->QueryBoolText(&config.buffer_pool_huge_pages);
+    }
+
+    // --- Parse Real-time Settings ---
+    // <realtime><loop cpus=".." policy="other|fifo|rr" priority=".."/><ctrl_worker .../><mlockall>..</mlockall></realtime>
+    XMLElement *realtime_node = root->FirstChildElement("realtime");
+    if (realtime_node)
+    {
+        auto parse_profile = [](XMLElement *el, ThreadProfileConfig &profile)
+        {
+            if (!el)
+                return;
+            if (const char *cpus = el->Attribute("cpus"))
+                profile.cpus = cpus;
+            if (const char *policy = el->Attribute("policy"))
+                profile.policy = policy;
+            el->QueryIntAttribute("priority", &profile.priority);
+        };
+        parse_profile(realtime_node->FirstChildElement("loop"), config.realtime_loop);
+        parse_profile(realtime_node->FirstChildElement("ctrl_worker"), config.realtime_ctrl_worker);
+        XMLElement *mlockall_node = realtime_node->FirstChildElement("mlockall");
+        if (mlockall_node)
+            mlockall_node->QueryBoolText(&config.realtime_mlockall);
     }
 
     // --- Parse UDP Settings ---
@@ -129,6 +240,41 @@ AppConfig load_config(const char *filename, int instance)
             config.udp_remote_ip = ip_text;
         else
             throw std::runtime_error("Missing <remote_ip>");
+
+        // Optional downlink egress batching knobs
+        XMLElement *batch_el = udp_node->FirstChildElement("send_batch_size");
+        if (batch_el)
+            batch_el->QueryIntText(&config.udp_send_batch_size);
+        XMLElement *delay_el = udp_node->FirstChildElement("send_batch_delay_us");
+        if (delay_el)
+            delay_el->QueryIntText(&config.udp_send_batch_delay_us);
+
+        // Optional uplink receive batching
+        XMLElement *rx_batch_el = udp_node->FirstChildElement("receive_batch_size");
+        if (rx_batch_el)
+            rx_batch_el->QueryIntText(&config.udp_receive_batch_size);
+
+        // Optional downlink egress queue settings
+        XMLElement *queue_el = udp_node->FirstChildElement("egress_queue_bytes");
+        if (queue_el)
+            queue_el->QueryIntText(&config.udp_egress_queue_bytes);
+        XMLElement *policy_el = udp_node->FirstChildElement("egress_drop_policy");
+        if (policy_el && policy_el->GetText())
+            config.udp_egress_drop_policy = policy_el->GetText();
+        XMLElement *gso_el = udp_node->FirstChildElement("gso_max_segments");
+        if (gso_el)
+            gso_el->QueryIntText(&config.udp_gso_max_segments);
+        XMLElement *gro_el = udp_node->FirstChildElement("gro");
+        if (gro_el)
+            gro_el->QueryBoolText(&config.udp_gro);
+
+        // Optional downlink shaper
+        XMLElement *rate_el = udp_node->FirstChildElement("rate_limit_bps");
+        if (rate_el)
+            rate_el->QueryInt64Text(&config.udp_rate_limit_bps);
+        XMLElement *burst_el = udp_node->FirstChildElement("rate_burst_bytes");
+        if (burst_el)
+            burst_el->QueryInt64Text(&config.udp_rate_burst_bytes);
     }
     else
     {
@@ -170,6 +316,18 @@ AppConfig load_config(const char *filename, int instance)
                 const char *name = el->Attribute("name");
                 if (name)
                     server_cfg.name = name;
+                el->QueryIntAttribute("shard", &server_cfg.shard);
+                el->QueryIntAttribute("priority", &server_cfg.priority);
+                el->QueryIntAttribute("weight", &server_cfg.weight);
+                // Framing of the messages this server receives; configs without it keep the
+                // framing implied by the standard server names
+                const char *framing = el->Attribute("framing");
+                if (framing)
+                    server_cfg.framing = framing;
+                else if (server_cfg.name.compare(0, 4, "FSW_") == 0)
+                    server_cfg.framing = "raw";
+                else if (server_cfg.name.compare(0, 8, "DL_PLMG_") == 0 || server_cfg.name.compare(0, 6, "DL_EL_") == 0)
+                    server_cfg.framing = "fcom_datalink";
                 XMLElement *path_el = el->FirstChildElement("path");
                 if (!path_el || !path_el->GetText() || std::string(path_el->GetText()).empty())
                     throw std::runtime_error(std::string("UDS server '") + (name ? std::string(name) : "<unnamed>") + "' missing <path> element or value");
@@ -177,6 +335,9 @@ AppConfig load_config(const char *filename, int instance)
                 XMLElement *buf_el = el->FirstChildElement("receive_buffer_size");
                 if (buf_el)
                     buf_el->QueryIntText(&server_cfg.receive_buffer_size);
+                XMLElement *batch_el = el->FirstChildElement("batch_size");
+                if (batch_el)
+                    batch_el->QueryIntText(&server_cfg.batch_size);
                 if (!server_cfg.path.empty())
                     config.uds_servers.push_back(server_cfg);
             }
@@ -215,10 +376,11 @@ AppConfig load_config(const char *filename, int instance)
     }
 
     // --- Parse ctrl/status UDS for each app under <ctrl_status_uds> ---
-    // <ctrl_status_uds><FSW>...</FSW><PLMG>...</PLMG>...</ctrl_status_uds>
+    // <ctrl_status_uds queue_size=".."><FSW>...</FSW><PLMG>...</PLMG>...</ctrl_status_uds>
     XMLElement *ctrl_status_node = root->FirstChildElement("ctrl_status_uds");
     if (ctrl_status_node)
     {
+        ctrl_status_node->QueryIntAttribute("queue_size", &config.ctrl_queue_size);
         for (XMLElement *app_node = ctrl_status_node->FirstChildElement(); app_node != nullptr; app_node = app_node->NextSiblingElement())
         {
             std::string section = app_node->Name();
@@ -272,6 +434,10 @@ AppConfig load_config(const char *filename, int instance)
         // If instance >= 0, assign unique UDP ports per instance (for multi-instance)
         config.udp_local_port = 9910 + instance;
         config.udp_remote_port = 9010 + instance;
+
+        // One metrics port per instance (k8s pods each have their own network namespace)
+        if (config.metrics_tcp_port > 0)
+            config.metrics_tcp_port += instance;
     }
 
     return config;
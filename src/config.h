@@ -7,9 +7,16 @@
 //   - udp_local_port: Local UDP port for FSL
 //   - udp_remote_ip: Remote IP address for UDP communication
 //   - udp_remote_port: Remote UDP port
+//   - udp_send_batch_size / udp_send_batch_delay_us: Downlink sendmmsg batching knobs
+//   - udp_receive_batch_size: Uplink recvmmsg batch size
+//   - udp_egress_queue_bytes / udp_egress_drop_policy: Downlink egress queue bound and drop policy
+//   - udp_gso_max_segments: Downlink UDP GSO (0 = off)
+//   - udp_gro: Uplink UDP GRO
+//   - udp_rate_limit_bps / udp_rate_burst_bytes: Downlink token-bucket shaper (0 = off)
 //   - uds_servers: List of UDS server socket paths (downlink)
 //   - uds_clients: Map of UDS client names to paths (uplink)
 //   - ul_uds_mapping: Map of message opcodes to UDS client names (for uplink routing)
+//   - metrics_uds_path / metrics_tcp_port: OpenMetrics endpoint (off when both are unset)
 //
 // Function:
 //   - load_config(const char *filename): Parses config.xml and returns AppConfig
@@ -29,11 +36,30 @@ struct CtrlUdsConfig
     int response_buffer_size = 0;
 };
 
+// Default number of datagrams drained per recvmmsg() on a downlink UDS server
+static const int DEFAULT_UDS_BATCH_SIZE = 8;
+static const int DEFAULT_CTRL_QUEUE_SIZE = 32;
+// Async logging: records per logging thread ring (<logging><async ring_records="..">)
+static const int DEFAULT_LOG_RING_RECORDS = 256;
+
 struct UdsServerConfig
 {
     std::string name;
     std::string path;
     int receive_buffer_size = 0;
+    int batch_size = DEFAULT_UDS_BATCH_SIZE; ///< Max datagrams received per wakeup (recvmmsg)
+    int shard = 0;                           ///< Downlink shard (loop thread) serving this server
+    int priority = 0;                        ///< Downlink scheduling: higher levels are served first
+    int weight = 1;                          ///< Share of its priority level (deficit round robin)
+    std::string framing;                     ///< "raw" (FSW) or "fcom_datalink" (PLMG, EL)
+};
+
+// CPU affinity and scheduling of one FSL thread (<realtime><loop>/<ctrl_worker>)
+struct ThreadProfileConfig
+{
+    std::string cpus;             ///< CPU list ("2", "0-1,3"), empty = inherited
+    std::string policy = "other"; ///< "other", "fifo" or "rr"
+    int priority = 0;             ///< 1..99 for fifo/rr, 0 for other
 };
 
 struct AppConfig
@@ -43,6 +69,29 @@ struct AppConfig
     std::string udp_remote_ip; ///< Remote IP address for UDP communication
     int udp_remote_port;       ///< Remote UDP port
 
+    // Downlink egress: max datagrams per sendmmsg() and max time a datagram may wait for a batch
+    int udp_send_batch_size = 16;
+    int udp_send_batch_delay_us = 0;
+
+    // Uplink: max datagrams drained per recvmmsg() on the UDP socket
+    int udp_receive_batch_size = 16;
+
+    // Downlink egress queue: bytes parked while the UDP send buffer is full, and what to
+    // drop when it overflows ("drop_newest" or "drop_oldest")
+    int udp_egress_queue_bytes = 4 * 1024 * 1024;
+    std::string udp_egress_drop_policy = "drop_newest";
+
+    // Downlink UDP GSO: max equally sized datagrams per sendmsg() (0 = off, up to 64)
+    int udp_gso_max_segments = 0;
+
+    // Uplink UDP GRO: receive trains of equally sized datagrams coalesced (poll/epoll backends)
+    bool udp_gro = false;
+
+    // Downlink shaper: link rate in bits per second (0 = unlimited) and token-bucket depth
+    // in bytes (largest burst sent at line rate); the rate can be changed at runtime
+    int64_t udp_rate_limit_bps = 0;
+    int64_t udp_rate_burst_bytes = 64 * 1024;
+
     // Downlink: UDS servers (one or more per each app)
     std::vector<UdsServerConfig> uds_servers;
 
@@ -55,8 +104,42 @@ struct AppConfig
     // Ctrl/Status: ctrl_uds_name -> CtrlUdsConfig
     std::map<std::string, CtrlUdsConfig> ctrl_uds_name;
 
+    // Ctrl requests waiting for the ctrl worker (<ctrl_status_uds queue_size="..">)
+    int ctrl_queue_size = DEFAULT_CTRL_QUEUE_SIZE;
+
+    // Event loop backend: "poll", "epoll" or "io_uring"
+    std::string event_loop_backend = "poll";
+
+    // Threading (poll/epoll): "single" loop, or "split" uplink and downlink loop threads
+    std::string event_loop_threading = "single";
+
+    // Downlink shards (poll/epoll): each shard is a loop thread with its own UDP socket,
+    // serving the UDS servers whose shard attribute selects it
+    int event_loop_downlink_shards = 1;
+
+    // io_uring backend: submission queue entries and provided buffers per buffer ring
+    // (downlink and uplink each get one ring of this many MTU-sized buffers; power of two)
+    int event_loop_uring_entries = 256;
+    int event_loop_uring_buffers = 64;
+
+    // Message buffer pool: back the slab with huge pages (MAP_HUGETLB) when available
+    bool buffer_pool_huge_pages = false;
+
+    // Real-time profile: event loop threads, ctrl worker thread, and mlockall() at startup
+    ThreadProfileConfig realtime_loop;
+    ThreadProfileConfig realtime_ctrl_worker;
+    bool realtime_mlockall = false;
+
     // Logging level (e.g., "DEBUG", "INFO", "WARN", "ERROR")
     std::string logging_level = "INFO";
+    // Asynchronous logging (background writer, per-thread rings) and ring size in records
+    bool logging_async = false;
+    int logging_async_ring_records = DEFAULT_LOG_RING_RECORDS;
+
+    // Metrics endpoint (OpenMetrics over HTTP): Unix stream socket path and 127.0.0.1 TCP
+    // port (empty / 0 = not served)
+    std::string metrics_uds_path;
+    int metrics_tcp_port = 0;
 };
 
 AppConfig load_config(const char *filename, int instance); ///< Parses config.xml and returns AppConfig, optionally rewriting UDS paths for instance
\ No newline at end of file
@@ -37,6 +37,8 @@ enum FslCtrlOpcode : uint8_t
     FSL_CTRL_OP_GET_CBIT = 1,    ///< Query CBIT/status
     FSL_CTRL_OP_SET_OPER = 2,    ///< Set FSL to OPER state
     FSL_CTRL_OP_SET_STANDBY = 3, ///< Set FSL to STANDBY state
+    FSL_CTRL_OP_SET_DL_RATE = 4, ///< Set the downlink rate limit (FslCtrlSetDlRateRequest)
+    FSL_CTRL_OP_GET_STATS = 5,   ///< Query traffic counters (FslCtrlGetStatsResponse)
 };
 
 /// Error codes for ctrl/status protocol responses
@@ -47,6 +49,7 @@ enum FslCtrlErrorCode : uint8_t
     FSL_CTRL_ERR_NOT_ALLOWED = 2,    ///< Not allowed error
     FSL_CTRL_ERR_INTERNAL = 3,       ///< Internal error
     FSL_CTRL_ERR_QUEUE_FULL = 4,     ///< Ctrl message queue is full (buffer overflow)
+    FSL_CTRL_ERR_INVALID_PARAM = 5,  ///< Request payload missing or out of range
 };
 
 /// Error codes for data-link protocol responses
@@ -88,6 +91,60 @@ typedef struct FslCtrlGetCbitResponse
     FslCtrlErrorCode error_code; ///< Error code
 } FslCtrlGetCbitResponse;
 
+/// Request to SET_DL_RATE (downlink token-bucket shaper)
+typedef struct FslCtrlSetDlRateRequest
+{
+    FslCtrlHeader header;
+    uint64_t rate_bps;    ///< Downlink rate limit (bits/s, 0 = unlimited)
+    uint32_t burst_bytes; ///< Token bucket depth (bytes, 0 = keep the current depth)
+} FslCtrlSetDlRateRequest;
+
+/// Response to SET_DL_RATE: the settings in effect (NOT_ALLOWED: the backend does not shape)
+typedef struct FslCtrlSetDlRateResponse
+{
+    FslCtrlHeader header;
+    uint64_t rate_bps;    ///< Downlink rate limit (bits/s, 0 = unlimited)
+    uint32_t burst_bytes; ///< Token bucket depth (bytes)
+} FslCtrlSetDlRateResponse;
+
+/// Channel kinds in a GET_STATS response
+enum FslStatsChannelType : uint8_t
+{
+    FSL_STATS_DL_SERVER = 1, ///< Downlink UDS server (id: <server> index in config order)
+    FSL_STATS_UL_ROUTE = 2,  ///< Uplink route (id: GslFslHeader opcode)
+    FSL_STATS_CTRL = 3,      ///< Ctrl request channel (id: index of the app name in alphabetical order)
+};
+
+/// Counters of one channel in a GET_STATS response (since FSL start)
+typedef struct FslStatsRecord
+{
+    FslStatsChannelType type; ///< Channel kind
+    uint8_t reserved;
+    uint16_t id;              ///< Channel id (see FslStatsChannelType)
+    uint32_t reserved2;
+    uint64_t datagrams;       ///< Datagrams received
+    uint64_t bytes;           ///< Payload bytes received
+    uint64_t drops;           ///< Datagrams not forwarded
+    uint64_t eagain;          ///< Sends that found the destination socket full
+    uint64_t truncated;       ///< Datagrams truncated on receive
+    uint64_t latency_count;   ///< Datagrams with a measured latency (forwarded / requests processed)
+    uint64_t latency_p50_ns;  ///< Latency percentiles (ns, bucket upper bound, <= 12.5% above the
+    uint64_t latency_p99_ns;  ///< value): downlink UDS receive to UDP send, uplink UDP receive to
+    uint64_t latency_p999_ns; ///< UDS send, ctrl request receive to processed
+    uint64_t latency_max_ns;  ///< Largest latency measured
+} FslStatsRecord;
+
+/// Response to GET_STATS, followed by record_count FslStatsRecord
+/// (ctrl_length covers the records too)
+typedef struct FslCtrlGetStatsResponse
+{
+    FslCtrlHeader header;
+    uint16_t record_count; ///< Number of FslStatsRecord after this struct
+    uint16_t reserved;
+    uint32_t reserved2;
+    uint64_t ul_unrouted;  ///< Uplink datagrams with no <ul_uds_mapping> entry
+} FslCtrlGetStatsResponse;
+
 typedef struct FslDataLinkErrorResponse
 {
     uint16_t opcode;                 ///< Original message opcode
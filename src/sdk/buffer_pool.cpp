@@ -0,0 +1,243 @@
+// buffer_pool.cpp - Implementation of BufferPool and PoolBuffer
+//
+// Buffer i lives at slab_ + i * stride_. The free list is a Treiber stack threaded
+// through Slot::next; every successful push/pop bumps the tag in the upper half of
+// head_, so a compare-exchange cannot succeed against a head that was popped and
+// pushed back in between (ABA).
+
+#include "buffer_pool.h"
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr size_t CACHE_LINE = 64;
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+size_t roundUp(size_t n, size_t align)
+{
+    return (n + align - 1) / align * align;
+}
+
+uint64_t nextHead(uint64_t head, uint32_t top)
+{
+    return (((head >> 32) + 1) << 32) | top;
+}
+} // namespace
+
+// --- PoolBuffer ---
+
+PoolBuffer::PoolBuffer() : pool_(nullptr), index_(0) {}
+
+PoolBuffer::PoolBuffer(BufferPool *pool, uint32_t index) : pool_(pool), index_(index) {}
+
+PoolBuffer::PoolBuffer(const PoolBuffer &other) : pool_(other.pool_), index_(other.index_)
+{
+    if (pool_)
+        pool_->addRef(index_);
+}
+
+PoolBuffer::PoolBuffer(PoolBuffer &&other) noexcept : pool_(other.pool_), index_(other.index_)
+{
+    other.pool_ = nullptr;
+}
+
+PoolBuffer &PoolBuffer::operator=(const PoolBuffer &other)
+{
+    if (this != &other)
+    {
+        if (other.pool_)
+            other.pool_->addRef(other.index_);
+        reset();
+        pool_ = other.pool_;
+        index_ = other.index_;
+    }
+    return *this;
+}
+
+PoolBuffer &PoolBuffer::operator=(PoolBuffer &&other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        pool_ = other.pool_;
+        index_ = other.index_;
+        other.pool_ = nullptr;
+    }
+    return *this;
+}
+
+PoolBuffer::~PoolBuffer()
+{
+    reset();
+}
+
+PoolBuffer::operator bool() const
+{
+    return pool_ != nullptr;
+}
+
+uint8_t *PoolBuffer::data() const
+{
+    return pool_ ? pool_->slab_ + index_ * pool_->stride_ : nullptr;
+}
+
+size_t PoolBuffer::capacity() const
+{
+    return pool_ ? pool_->buffer_size_ : 0;
+}
+
+size_t PoolBuffer::length() const
+{
+    return pool_ ? pool_->slots_[index_].length : 0;
+}
+
+void PoolBuffer::setLength(size_t length)
+{
+    if (pool_)
+        pool_->slots_[index_].length = length;
+}
+
+void PoolBuffer::reset()
+{
+    if (pool_)
+    {
+        pool_->release(index_);
+        pool_ = nullptr;
+    }
+}
+
+// --- BufferPool ---
+
+BufferPool::BufferPool(size_t count, size_t buffer_size, bool huge_pages)
+    : count_(count), buffer_size_(buffer_size), stride_(roundUp(buffer_size, CACHE_LINE)),
+      slab_(nullptr), slab_bytes_(0), huge_pages_(false),
+      head_(0), available_(0), exhausted_(0)
+{
+    if (count == 0 || count >= std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("BufferPool: invalid buffer count " + std::to_string(count));
+    if (buffer_size == 0)
+        throw std::runtime_error("BufferPool: invalid buffer size");
+
+    void *mem = MAP_FAILED;
+    if (huge_pages)
+    {
+        slab_bytes_ = roundUp(count * stride_, HUGE_PAGE_SIZE);
+        mem = mmap(nullptr, slab_bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        huge_pages_ = (mem != MAP_FAILED);
+    }
+    if (mem == MAP_FAILED)
+    {
+        slab_bytes_ = roundUp(count * stride_, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+        mem = mmap(nullptr, slab_bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (mem == MAP_FAILED)
+        throw std::runtime_error(std::string("BufferPool: failed to map ") + std::to_string(count * stride_) + " bytes: " + strerror(errno));
+    slab_ = static_cast<uint8_t *>(mem);
+
+    // Prefault: the whole pool is resident from startup, not on first use in the hot path
+    memset(slab_, 0, slab_bytes_);
+
+    slots_.reset(new Slot[count]);
+    for (size_t i = count; i > 0; --i)
+    {
+        slots_[i - 1].refs.store(0, std::memory_order_relaxed);
+        slots_[i - 1].length = 0;
+        push(static_cast<uint32_t>(i - 1));
+    }
+}
+
+BufferPool::~BufferPool()
+{
+    munmap(slab_, slab_bytes_);
+}
+
+PoolBuffer BufferPool::acquire()
+{
+    uint32_t index;
+    if (!pop(index))
+    {
+        exhausted_.fetch_add(1, std::memory_order_relaxed);
+        return PoolBuffer();
+    }
+    slots_[index].refs.store(1, std::memory_order_relaxed);
+    slots_[index].length = 0;
+    return PoolBuffer(this, index);
+}
+
+size_t BufferPool::capacity() const
+{
+    return count_;
+}
+
+size_t BufferPool::bufferSize() const
+{
+    return buffer_size_;
+}
+
+size_t BufferPool::available() const
+{
+    return available_.load(std::memory_order_relaxed);
+}
+
+size_t BufferPool::slabBytes() const
+{
+    return slab_bytes_;
+}
+
+bool BufferPool::hugePages() const
+{
+    return huge_pages_;
+}
+
+uint64_t BufferPool::exhausted() const
+{
+    return exhausted_.load(std::memory_order_relaxed);
+}
+
+void BufferPool::addRef(uint32_t index)
+{
+    slots_[index].refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void BufferPool::release(uint32_t index)
+{
+    // acq_rel: writes made through any handle happen before the buffer is reused
+    if (slots_[index].refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        push(index);
+}
+
+void BufferPool::push(uint32_t index)
+{
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t next;
+    do
+    {
+        slots_[index].next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        next = nextHead(head, index + 1);
+    } while (!head_.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+    available_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool BufferPool::pop(uint32_t &index)
+{
+    uint64_t head = head_.load(std::memory_order_acquire);
+    for (;;)
+    {
+        uint32_t top = static_cast<uint32_t>(head);
+        if (top == 0)
+            return false;
+        uint32_t below = slots_[top - 1].next.load(std::memory_order_relaxed);
+        if (head_.compare_exchange_weak(head, nextHead(head, below), std::memory_order_acquire, std::memory_order_acquire))
+        {
+            index = top - 1;
+            available_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
@@ -0,0 +1,125 @@
+// buffer_pool.h - Fixed-capacity, lock-free pool of message buffers
+//
+// BufferPool carves one slab, mapped once at construction, into count buffers of
+// buffer_size bytes. Free buffers are kept on a lock-free stack of buffer indices
+// (Treiber stack, ABA tag in the head word), so buffers can be acquired and released
+// from any thread without locks or heap allocation.
+//
+// PoolBuffer is a reference-counted handle to one buffer. Copies share the buffer;
+// it goes back to the pool when the last handle is destroyed. A received message can
+// therefore be handed from the event loop to a worker thread without copying.
+//
+// The slab is prefaulted at construction, so the pool is resident and its size
+// (slabBytes()) is known at startup. With huge_pages the slab is first mapped with
+// MAP_HUGETLB; if no huge pages are reserved it falls back to normal pages.
+//
+// Usage:
+//   - BufferPool pool(count, buffer_size, huge_pages)
+//   - PoolBuffer buf = pool.acquire(); if (!buf) the pool is exhausted
+//   - buf.setLength(socket.receive(buf.data(), buf.capacity()))
+//   - queue.push(std::move(buf)); the buffer is released with its last handle
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class BufferPool;
+
+// PoolBuffer: reference-counted handle to one BufferPool buffer (empty if default constructed)
+class PoolBuffer
+{
+public:
+    PoolBuffer();
+    PoolBuffer(const PoolBuffer &other);
+    PoolBuffer(PoolBuffer &&other) noexcept;
+    PoolBuffer &operator=(const PoolBuffer &other);
+    PoolBuffer &operator=(PoolBuffer &&other) noexcept;
+    ~PoolBuffer();
+
+    // True if the handle refers to a buffer
+    explicit operator bool() const;
+
+    // Start of the buffer (nullptr if empty)
+    uint8_t *data() const;
+
+    // Size of the buffer in bytes
+    size_t capacity() const;
+
+    // Number of valid bytes (shared by all handles to the buffer)
+    size_t length() const;
+    void setLength(size_t length);
+
+    // Drop this handle (the buffer returns to the pool with its last handle)
+    void reset();
+
+private:
+    friend class BufferPool;
+    PoolBuffer(BufferPool *pool, uint32_t index);
+
+    BufferPool *pool_;
+    uint32_t index_;
+};
+
+// BufferPool: slab of equally sized buffers with a lock-free free list
+class BufferPool
+{
+public:
+    // Constructor: map and prefault count buffers of buffer_size bytes (throws std::runtime_error)
+    BufferPool(size_t count, size_t buffer_size, bool huge_pages = false);
+
+    // Destructor: unmaps the slab (all handles must be gone)
+    ~BufferPool();
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    // Take a free buffer (length 0), or an empty handle if the pool is exhausted
+    PoolBuffer acquire();
+
+    // Number of buffers
+    size_t capacity() const;
+
+    // Size of each buffer in bytes
+    size_t bufferSize() const;
+
+    // Number of free buffers
+    size_t available() const;
+
+    // Bytes mapped for the slab
+    size_t slabBytes() const;
+
+    // True if the slab is backed by huge pages (MAP_HUGETLB)
+    bool hugePages() const;
+
+    // Number of acquire() calls that found the pool exhausted
+    uint64_t exhausted() const;
+
+private:
+    friend class PoolBuffer;
+
+    struct Slot
+    {
+        std::atomic<uint32_t> refs;
+        std::atomic<uint32_t> next; // free list link: index + 1, 0 = end
+        size_t length;
+    };
+
+    void addRef(uint32_t index);
+    void release(uint32_t index);
+    void push(uint32_t index);
+    bool pop(uint32_t &index);
+
+    size_t count_;
+    size_t buffer_size_;
+    size_t stride_; // buffer_size rounded up to a cache line
+    uint8_t *slab_;
+    size_t slab_bytes_;
+    bool huge_pages_;
+    std::unique_ptr<Slot[]> slots_;
+    // Free list head: (ABA tag << 32) | (index + 1), low word 0 = empty
+    std::atomic<uint64_t> head_;
+    std::atomic<size_t> available_;
+    std::atomic<uint64_t> exhausted_;
+};
@@ -0,0 +1,29 @@
+// channel_counters.h - Lock-free per-channel traffic counters
+//
+// One ChannelCounters per channel (UDS server, uplink route, ctrl channel), on its own
+// cache line so loop threads updating different channels never share a line. Counters are
+// relaxed atomics: the forwarding thread adds, any thread (ctrl worker, shutdown stats)
+// may read a snapshot at any time without stopping it.
+//
+// Usage:
+//   - ChannelCounters counters;
+//   - counters.add(counters.datagrams, 1) on the hot path
+//   - counters.datagrams.load(std::memory_order_relaxed) from a reader
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+struct alignas(64) ChannelCounters
+{
+    std::atomic<uint64_t> datagrams{0}; // datagrams received on the channel
+    std::atomic<uint64_t> bytes{0};     // payload bytes received on the channel
+    std::atomic<uint64_t> drops{0};     // datagrams not forwarded (framing error, queue full, peer not draining)
+    std::atomic<uint64_t> eagain{0};    // sends that found the destination socket full
+    std::atomic<uint64_t> truncated{0}; // datagrams larger than their receive buffer
+
+    static void add(std::atomic<uint64_t> &counter, uint64_t n)
+    {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+};
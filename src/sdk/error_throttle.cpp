@@ -0,0 +1,119 @@
+// error_throttle.cpp - Implementation of ErrorThrottle
+//
+// report() always counts; only the caller that moves window_start_ns_ forward (one CAS
+// per interval) takes the pending count and logs it, so concurrent reporters never block
+// and never log the same failures twice.
+
+#include "error_throttle.h"
+#include "logger.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+int64_t steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+ErrorThrottle::ErrorThrottle(std::string what, std::string channel, int64_t interval_ns)
+    : what_(std::move(what)), channel_(std::move(channel)), interval_ns_(interval_ns > 0 ? interval_ns : DEFAULT_INTERVAL_NS)
+{
+}
+
+ErrorThrottle::~ErrorThrottle()
+{
+    flush();
+}
+
+void ErrorThrottle::report(int err, uint64_t count)
+{
+    report(err, count, steadyNowNs());
+}
+
+void ErrorThrottle::report(int err, uint64_t count, int64_t now_ns)
+{
+    total_.fetch_add(count, std::memory_order_relaxed);
+    pending_.fetch_add(count, std::memory_order_relaxed);
+    last_errno_.store(err, std::memory_order_relaxed);
+
+    int64_t start = window_start_ns_.load(std::memory_order_relaxed);
+    if (start != 0 && now_ns - start < interval_ns_)
+        return;
+    if (!window_start_ns_.compare_exchange_strong(start, now_ns, std::memory_order_relaxed))
+        return; // another thread logs this interval
+    uint64_t n = pending_.exchange(0, std::memory_order_relaxed);
+    if (n > 0)
+        log(n, err, start == 0 ? 0 : now_ns - start);
+}
+
+uint64_t ErrorThrottle::total() const
+{
+    return total_.load(std::memory_order_relaxed);
+}
+
+void ErrorThrottle::flush()
+{
+    uint64_t n = pending_.exchange(0, std::memory_order_relaxed);
+    if (n == 0)
+        return;
+    int64_t now = steadyNowNs();
+    int64_t start = window_start_ns_.exchange(now, std::memory_order_relaxed);
+    log(n, last_errno_.load(std::memory_order_relaxed), start == 0 ? 0 : now - start);
+}
+
+std::string ErrorThrottle::errnoName(int err)
+{
+    switch (err)
+    {
+    case EAGAIN:
+        return "EAGAIN";
+    case ENOBUFS:
+        return "ENOBUFS";
+    case ECONNREFUSED:
+        return "ECONNREFUSED";
+    case ENOENT:
+        return "ENOENT";
+    case EMSGSIZE:
+        return "EMSGSIZE";
+    case EINTR:
+        return "EINTR";
+    case EINVAL:
+        return "EINVAL";
+    case EPERM:
+        return "EPERM";
+    case EIO:
+        return "EIO";
+    case ENOTCONN:
+        return "ENOTCONN";
+    case EHOSTUNREACH:
+        return "EHOSTUNREACH";
+    case ENETUNREACH:
+        return "ENETUNREACH";
+    default:
+        return strerror(err);
+    }
+}
+
+void ErrorThrottle::log(uint64_t count, int err, int64_t elapsed_ns)
+{
+    std::string line = what_;
+    if (!channel_.empty())
+        line += " on " + channel_;
+    if (err != 0)
+        line += ": " + errnoName(err);
+    if (count > 1)
+    {
+        char summary[64];
+        if (elapsed_ns > 0)
+            snprintf(summary, sizeof(summary), " x %llu in last %.1fs", static_cast<unsigned long long>(count), elapsed_ns / 1e9);
+        else
+            snprintf(summary, sizeof(summary), " x %llu", static_cast<unsigned long long>(count));
+        line += (err != 0 ? "" : ":");
+        line += summary;
+    }
+    Logger::error(line);
+}
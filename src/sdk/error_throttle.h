@@ -0,0 +1,59 @@
+// error_throttle.h - Rate-limited, aggregated error reporting for hot-path failures
+//
+// A failing socket (e.g. the GSL or an application no longer draining) fails every send,
+// and one log line per failure would itself slow the forwarding loop. An ErrorThrottle
+// belongs to one call site and channel: the first failure after a quiet interval is
+// logged at once, later ones are only counted (lock-free atomics, safe from any thread)
+// and logged as one summary per interval:
+//   "UDS send failed on /tmp/fcom_to_fsw_ul: EAGAIN x 48213 in last 1.0s"
+// Failures still pending when the errors stop are logged by the next report(), by
+// flush() or when the throttle is destroyed (e.g. with its socket at shutdown).
+//
+// Usage:
+//   - ErrorThrottle send_errors("UDS send failed", path);
+//   - on failure: send_errors.report(errno);        // or report(0, dropped_count)
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+class ErrorThrottle
+{
+public:
+    // Default summary interval
+    static constexpr int64_t DEFAULT_INTERVAL_NS = 1000000000;
+
+    // what: the failing operation; channel: socket path, server name, ... (may be empty)
+    explicit ErrorThrottle(std::string what, std::string channel = std::string(), int64_t interval_ns = DEFAULT_INTERVAL_NS);
+    ~ErrorThrottle(); // flush()
+
+    ErrorThrottle(const ErrorThrottle &) = delete;
+    ErrorThrottle &operator=(const ErrorThrottle &) = delete;
+
+    // Count count failures with errno err (0 = no errno); logs at most once per interval
+    void report(int err, uint64_t count = 1);
+    void report(int err, uint64_t count, int64_t now_ns);
+
+    // Failures counted since construction (logged or not)
+    uint64_t total() const;
+
+    // Log the failures counted but not yet logged
+    void flush();
+
+    // Short errno name ("EAGAIN", "ENOBUFS", ...), strerror() for uncommon values
+    static std::string errnoName(int err);
+
+private:
+    void log(uint64_t count, int err, int64_t elapsed_ns);
+
+    const std::string what_;
+    const std::string channel_;
+    const int64_t interval_ns_;
+    // Start of the current interval (0 = nothing logged yet)
+    std::atomic<int64_t> window_start_ns_{0};
+    // Failures counted since the last log line
+    std::atomic<uint64_t> pending_{0};
+    std::atomic<int> last_errno_{0};
+    std::atomic<uint64_t> total_{0};
+};
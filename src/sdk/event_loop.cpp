@@ -0,0 +1,225 @@
+// event_loop.cpp - poll() and epoll() implementations of EventLoop
+//
+// PollEventLoop keeps pollfd entries and handlers in parallel vectors, so every
+// wakeup scans all registered fds. EpollEventLoop stores the handler pointer in
+// epoll_event.data, so dispatch touches only the fds the kernel reported ready.
+
+#include "event_loop.h"
+#include <cerrno>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+bool parseEventLoopBackend(const std::string &name, EventLoopBackend &backend)
+{
+    if (name == "poll")
+    {
+        backend = EventLoopBackend::POLL;
+        return true;
+    }
+    if (name == "epoll")
+    {
+        backend = EventLoopBackend::EPOLL;
+        return true;
+    }
+    return false;
+}
+
+namespace
+{
+
+// --- poll() backend ---
+class PollEventLoop : public EventLoop
+{
+public:
+    bool add(int fd, uint32_t events, EventHandler *handler) override
+    {
+        if (index_.count(fd))
+            return false;
+        pollfd pfd = {};
+        pfd.fd = fd;
+        pfd.events = toPoll(events);
+        index_[fd] = fds_.size();
+        fds_.push_back(pfd);
+        handlers_.push_back(handler);
+        return true;
+    }
+
+    bool modify(int fd, uint32_t events) override
+    {
+        auto it = index_.find(fd);
+        if (it == index_.end())
+            return false;
+        fds_[it->second].events = toPoll(events);
+        return true;
+    }
+
+    bool remove(int fd) override
+    {
+        auto it = index_.find(fd);
+        if (it == index_.end())
+            return false;
+        size_t i = it->second;
+        size_t last = fds_.size() - 1;
+        if (i != last)
+        {
+            fds_[i] = fds_[last];
+            handlers_[i] = handlers_[last];
+            index_[fds_[i].fd] = i;
+        }
+        fds_.pop_back();
+        handlers_.pop_back();
+        index_.erase(it);
+        return true;
+    }
+
+    int runOnce(int timeout_ms) override
+    {
+        int ret = poll(fds_.data(), fds_.size(), timeout_ms);
+        if (ret <= 0)
+            return ret;
+
+        int dispatched = 0;
+        for (size_t i = 0; i < fds_.size() && dispatched < ret; ++i)
+        {
+            short revents = fds_[i].revents;
+            if (revents == 0)
+                continue;
+            ++dispatched;
+            handlers_[i]->onEvent(fromPoll(revents));
+        }
+        return dispatched;
+    }
+
+    const char *name() const override { return "poll"; }
+
+private:
+    static short toPoll(uint32_t events)
+    {
+        short out = 0;
+        if (events & EVENT_READ)
+            out |= POLLIN;
+        if (events & EVENT_WRITE)
+            out |= POLLOUT;
+        return out;
+    }
+
+    static uint32_t fromPoll(short revents)
+    {
+        uint32_t out = 0;
+        if (revents & POLLIN)
+            out |= EVENT_READ;
+        if (revents & POLLOUT)
+            out |= EVENT_WRITE;
+        if (revents & (POLLERR | POLLHUP | POLLNVAL))
+            out |= EVENT_ERROR;
+        return out;
+    }
+
+    std::vector<pollfd> fds_;
+    std::vector<EventHandler *> handlers_;
+    std::unordered_map<int, size_t> index_;
+};
+
+// --- epoll() backend (level-triggered) ---
+class EpollEventLoop : public EventLoop
+{
+public:
+    static constexpr int MAX_EVENTS = 64;
+
+    EpollEventLoop() : epfd_(epoll_create1(EPOLL_CLOEXEC)), events_(MAX_EVENTS)
+    {
+        if (epfd_ < 0)
+            throw std::runtime_error("epoll_create1 failed");
+    }
+
+    ~EpollEventLoop() override
+    {
+        close(epfd_);
+    }
+
+    bool add(int fd, uint32_t events, EventHandler *handler) override
+    {
+        epoll_event ev = {};
+        ev.events = toEpoll(events);
+        ev.data.ptr = handler;
+        if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0)
+            return false;
+        handlers_[fd] = handler;
+        return true;
+    }
+
+    bool modify(int fd, uint32_t events) override
+    {
+        auto it = handlers_.find(fd);
+        if (it == handlers_.end())
+            return false;
+        epoll_event ev = {};
+        ev.events = toEpoll(events);
+        ev.data.ptr = it->second;
+        return epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+    }
+
+    bool remove(int fd) override
+    {
+        if (handlers_.erase(fd) == 0)
+            return false;
+        return epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr) == 0;
+    }
+
+    int runOnce(int timeout_ms) override
+    {
+        int ret = epoll_wait(epfd_, events_.data(), MAX_EVENTS, timeout_ms);
+        for (int i = 0; i < ret; ++i)
+        {
+            static_cast<EventHandler *>(events_[i].data.ptr)->onEvent(fromEpoll(events_[i].events));
+        }
+        return ret;
+    }
+
+    const char *name() const override { return "epoll"; }
+
+private:
+    static uint32_t toEpoll(uint32_t events)
+    {
+        uint32_t out = 0;
+        if (events & EVENT_READ)
+            out |= EPOLLIN;
+        if (events & EVENT_WRITE)
+            out |= EPOLLOUT;
+        return out;
+    }
+
+    static uint32_t fromEpoll(uint32_t revents)
+    {
+        uint32_t out = 0;
+        if (revents & EPOLLIN)
+            out |= EVENT_READ;
+        if (revents & EPOLLOUT)
+            out |= EVENT_WRITE;
+        if (revents & (EPOLLERR | EPOLLHUP))
+            out |= EVENT_ERROR;
+        return out;
+    }
+
+    int epfd_;
+    std::vector<epoll_event> events_;
+    std::unordered_map<int, EventHandler *> handlers_;
+};
+
+} // namespace
+
+std::unique_ptr<EventLoop> EventLoop::create(EventLoopBackend backend)
+{
+    switch (backend)
+    {
+    case EventLoopBackend::EPOLL:
+        return std::unique_ptr<EventLoop>(new EpollEventLoop());
+    case EventLoopBackend::POLL:
+    default:
+        return std::unique_ptr<EventLoop>(new PollEventLoop());
+    }
+}
@@ -0,0 +1,83 @@
+// event_loop.h - Readiness-based event loop with poll() and epoll() backends
+//
+// EventLoop maps registered file descriptors to EventHandler objects and dispatches
+// readiness events to them. Two backends are provided:
+//   - POLL:  poll() over all registered fds, then a linear scan for ready ones
+//   - EPOLL: epoll_wait() returns only ready fds; each event carries its handler
+//            pointer, so wakeup cost is O(ready) instead of O(registered)
+//
+// Usage:
+//   - auto loop = EventLoop::create(EventLoopBackend::EPOLL)
+//   - loop->add(fd, EVENT_READ, &handler)
+//   - while (running) loop->runOnce(timeout_ms)
+//
+// Handlers may call modify() from onEvent(); add()/remove() must not be called
+// while runOnce() is dispatching.
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Readiness flags passed to add()/modify() and reported to EventHandler::onEvent()
+enum EventFlags : uint32_t
+{
+    EVENT_READ = 1u << 0,  ///< fd is readable
+    EVENT_WRITE = 1u << 1, ///< fd is writable
+    EVENT_ERROR = 1u << 2, ///< error or hangup (reported only)
+};
+
+// EventHandler: receives readiness events for one registered fd
+class EventHandler
+{
+public:
+    virtual ~EventHandler() {}
+    virtual void onEvent(uint32_t events) = 0;
+};
+
+// CallbackHandler: EventHandler that forwards to a callable
+class CallbackHandler : public EventHandler
+{
+public:
+    explicit CallbackHandler(std::function<void(uint32_t)> callback) : callback_(std::move(callback)) {}
+    void onEvent(uint32_t events) override { callback_(events); }
+
+private:
+    std::function<void(uint32_t)> callback_;
+};
+
+enum class EventLoopBackend
+{
+    POLL,
+    EPOLL
+};
+
+// Parse "poll" / "epoll"; returns false for unknown names
+bool parseEventLoopBackend(const std::string &name, EventLoopBackend &backend);
+
+// EventLoop: abstract readiness loop
+class EventLoop
+{
+public:
+    // Create a loop for the given backend (throws std::runtime_error on failure)
+    static std::unique_ptr<EventLoop> create(EventLoopBackend backend);
+
+    virtual ~EventLoop() {}
+
+    // Register fd for events (EVENT_READ/EVENT_WRITE); handler must outlive the registration
+    virtual bool add(int fd, uint32_t events, EventHandler *handler) = 0;
+
+    // Change the events of a registered fd
+    virtual bool modify(int fd, uint32_t events) = 0;
+
+    // Unregister fd
+    virtual bool remove(int fd) = 0;
+
+    // Wait up to timeout_ms (-1 = forever) and dispatch ready handlers
+    // Returns number of handlers dispatched, or -1 on error (errno set)
+    virtual int runOnce(int timeout_ms) = 0;
+
+    // Backend name for logging
+    virtual const char *name() const = 0;
+};
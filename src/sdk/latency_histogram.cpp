@@ -0,0 +1,90 @@
+// latency_histogram.cpp - Implementation of LatencyHistogram
+//
+// Bucket layout: values below SUB_BUCKETS have a bucket each; a value whose highest set bit
+// is m (m >= SUB_BUCKET_BITS) goes to octave m - SUB_BUCKET_BITS + 1, sub-bucket given by the
+// SUB_BUCKET_BITS bits below bit m.
+
+#include "latency_histogram.h"
+#include <time.h>
+
+void LatencyHistogram::record(int64_t latency_ns)
+{
+    uint64_t value = latency_ns > 0 ? static_cast<uint64_t>(latency_ns) : 0;
+    counts_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = max_ns_.load(std::memory_order_relaxed);
+    while (value > max && !max_ns_.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot s;
+    s.counts.resize(BUCKETS);
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+        s.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        s.count += s.counts[i]; // consistent with the buckets, unlike count_
+    }
+    s.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+    s.max_ns = max_ns_.load(std::memory_order_relaxed);
+    return s;
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value_ns)
+{
+    if (value_ns > MAX_TRACKABLE_NS)
+        value_ns = MAX_TRACKABLE_NS;
+    if (value_ns < SUB_BUCKETS)
+        return static_cast<size_t>(value_ns);
+    int msb = 63 - __builtin_clzll(value_ns);
+    int shift = msb - SUB_BUCKET_BITS;
+    return static_cast<size_t>(shift + 1) * SUB_BUCKETS + ((value_ns >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::bucketUpperNs(size_t index)
+{
+    if (index < SUB_BUCKETS)
+        return index;
+    int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+    uint64_t sub = index % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double q) const
+{
+    if (count == 0)
+        return 0;
+    // Rank of the value (1-based), at least the first one
+    uint64_t rank = static_cast<uint64_t>(q * count + 0.5);
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            uint64_t upper = bucketUpperNs(i);
+            return upper < max_ns ? upper : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+uint64_t LatencyHistogram::Snapshot::countAtOrBelow(uint64_t limit_ns) const
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < counts.size() && bucketUpperNs(i) <= limit_ns; ++i)
+        total += counts[i];
+    return total;
+}
+
+int64_t LatencyHistogram::nowNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
@@ -0,0 +1,65 @@
+// latency_histogram.h - Lock-free, log-bucketed latency histogram
+//
+// HDR-style buckets: every power of two is split into SUB_BUCKETS linear sub-buckets, so a
+// recorded value lands in a bucket at most 1/SUB_BUCKETS (12.5%) wider than itself, from
+// nanoseconds up to MAX_TRACKABLE_NS (longer values count in the last bucket). record() is
+// one relaxed fetch_add per bucket/count/sum, safe from any thread and never blocking;
+// snapshot() reads the buckets while recording goes on (each value is consistent, the
+// set of them only approximately).
+//
+// Times are CLOCK_REALTIME nanoseconds (nowNs()), the clock of SO_TIMESTAMPNS kernel
+// receive timestamps, so a kernel timestamp and a later nowNs() give the time in between.
+//
+// Usage:
+//   - LatencyHistogram latency;  latency.record(LatencyHistogram::nowNs() - receive_ns);
+//   - LatencyHistogram::Snapshot s = latency.snapshot();  s.percentile(0.99)
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class LatencyHistogram
+{
+public:
+    // Linear sub-buckets per power of two (precision) and the largest value told apart (~18 min)
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr uint64_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr int MAX_TRACKABLE_BITS = 40;
+    static constexpr uint64_t MAX_TRACKABLE_NS = (1ull << MAX_TRACKABLE_BITS) - 1;
+    static constexpr size_t BUCKETS = (MAX_TRACKABLE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    // Point-in-time copy of the histogram
+    struct Snapshot
+    {
+        std::vector<uint64_t> counts; // per bucket
+        uint64_t count = 0;
+        uint64_t sum_ns = 0;
+        uint64_t max_ns = 0;
+
+        // Value at or below which fraction q (0..1) of the recorded values fall: the upper
+        // bound of the bucket holding it, capped at max_ns (0 when empty)
+        uint64_t percentile(double q) const;
+        // Number of values recorded at or below limit_ns (exact for limit_ns = 2^n - 1)
+        uint64_t countAtOrBelow(uint64_t limit_ns) const;
+    };
+
+    // Record one latency (negative values, e.g. after a clock step, count as 0)
+    void record(int64_t latency_ns);
+
+    Snapshot snapshot() const;
+
+    // Bucket of a value, and the largest value a bucket holds
+    static size_t bucketIndex(uint64_t value_ns);
+    static uint64_t bucketUpperNs(size_t index);
+
+    // CLOCK_REALTIME now, in nanoseconds
+    static int64_t nowNs();
+
+private:
+    std::atomic<uint64_t> counts_[BUCKETS] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
@@ -1,12 +1,220 @@
-
 #include "logger.h"
+#include "mpsc_queue.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
 #include <chrono>
+#include <cstring>
 #include <iomanip>
+#include <memory>
 #include <sstream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
 
 LogLevel Logger::currentLevel = LogLevel::INFO;
 std::mutex Logger::logMutex;
 
+// --- Async mode ---
+// Each logging thread owns one ring (an MpscQueue with a single producer). The writer
+// snapshots the ring list, drains every ring into one batch, sorts it by time and writes
+// it with one write() per stream. Rings of exited threads are removed once drained.
+namespace
+{
+struct LogRecord
+{
+    int64_t time_ns;  // system_clock
+    uint16_t length;  // bytes used in text
+    LogLevel level;
+    char text[Logger::ASYNC_TEXT_BYTES];
+};
+
+struct AsyncRing
+{
+    explicit AsyncRing(size_t records) : queue(records) {}
+    MpscQueue<LogRecord> queue;
+    std::atomic<bool> closed{false}; // owning thread exited
+};
+
+// Records drained from one ring per writer pass (bounds the batch and its latency)
+constexpr size_t WRITER_BATCH_PER_RING = 256;
+// Writer sleep when every ring was empty
+constexpr auto WRITER_IDLE_SLEEP = std::chrono::milliseconds(1);
+
+std::mutex rings_mutex; // ring registration (once per thread) and the writer's snapshot
+std::vector<std::shared_ptr<AsyncRing>> rings;
+std::atomic<bool> async_enabled(false);
+std::atomic<uint32_t> async_generation(0); // bumped by startAsync(): stale thread rings are replaced
+std::atomic<uint64_t> dropped_records(0);
+size_t ring_records = Logger::DEFAULT_ASYNC_RING_RECORDS;
+std::thread writer;
+std::atomic<bool> writer_running(false);
+
+// The calling thread's ring; marked closed when the thread exits
+struct ThreadRing
+{
+    std::shared_ptr<AsyncRing> ring;
+    uint32_t generation = 0;
+    ~ThreadRing()
+    {
+        if (ring)
+            ring->closed.store(true, std::memory_order_release);
+    }
+};
+thread_local ThreadRing thread_ring;
+
+// Stops a writer still running at exit (destroyed before writer, which must not be joinable)
+struct WriterShutdown
+{
+    ~WriterShutdown()
+    {
+        Logger::stopAsync();
+    }
+} writer_shutdown;
+
+AsyncRing &threadRing()
+{
+    uint32_t generation = async_generation.load(std::memory_order_acquire);
+    if (!thread_ring.ring || thread_ring.generation != generation)
+    {
+        if (thread_ring.ring)
+            thread_ring.ring->closed.store(true, std::memory_order_release);
+        thread_ring.ring = std::make_shared<AsyncRing>(ring_records);
+        thread_ring.generation = generation;
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.push_back(thread_ring.ring);
+    }
+    return *thread_ring.ring;
+}
+
+const char *levelPrefix(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::ERROR:
+        return "[ERROR]";
+    case LogLevel::INFO:
+        return "[INFO]";
+    case LogLevel::DEBUG:
+        return "[DEBUG]";
+    }
+    return "";
+}
+
+void writeAll(int fd, const std::string &text)
+{
+    size_t done = 0;
+    while (done < text.size())
+    {
+        ssize_t n = ::write(fd, text.data() + done, text.size() - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        done += static_cast<size_t>(n);
+    }
+}
+
+// Timestamp formatting with the date/time part cached per second
+class TimeFormatter
+{
+public:
+    void append(std::string &out, int64_t time_ns)
+    {
+        int64_t seconds = time_ns / 1000000000;
+        if (seconds != cached_second_)
+        {
+            std::time_t t = static_cast<std::time_t>(seconds);
+            std::tm tm;
+            localtime_r(&t, &tm);
+            std::strftime(cached_, sizeof(cached_), "%Y-%m-%d %H:%M:%S", &tm);
+            cached_second_ = seconds;
+        }
+        char ms[8];
+        snprintf(ms, sizeof(ms), ",%03d", static_cast<int>(time_ns / 1000000 % 1000));
+        out += '[';
+        out += cached_;
+        out += ms;
+        out += "] ";
+    }
+
+private:
+    int64_t cached_second_ = -1;
+    char cached_[32] = {};
+};
+
+void writerLoop()
+{
+    std::vector<std::shared_ptr<AsyncRing>> snapshot;
+    std::vector<LogRecord> batch;
+    std::string out, err;
+    TimeFormatter time_formatter;
+    uint64_t reported_drops = 0;
+    LogRecord record;
+
+    for (;;)
+    {
+        bool running = writer_running.load(std::memory_order_acquire);
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            snapshot = rings;
+        }
+
+        batch.clear();
+        for (const auto &ring : snapshot)
+        {
+            bool closed = ring->closed.load(std::memory_order_acquire);
+            size_t n = 0;
+            while (n < WRITER_BATCH_PER_RING && ring->queue.tryPop(record))
+            {
+                batch.push_back(record);
+                ++n;
+            }
+            if (closed && n == 0 && ring->queue.size() == 0)
+            {
+                std::lock_guard<std::mutex> lock(rings_mutex);
+                rings.erase(std::remove(rings.begin(), rings.end(), ring), rings.end());
+            }
+        }
+
+        uint64_t drops = dropped_records.load(std::memory_order_relaxed);
+        if (batch.empty() && drops == reported_drops)
+        {
+            // Stop only once a pass after the stop request found nothing
+            if (!running)
+                break;
+            std::this_thread::sleep_for(WRITER_IDLE_SLEEP);
+            continue;
+        }
+
+        std::stable_sort(batch.begin(), batch.end(), [](const LogRecord &a, const LogRecord &b)
+                         { return a.time_ns < b.time_ns; });
+        out.clear();
+        err.clear();
+        for (const LogRecord &r : batch)
+        {
+            std::string &line = (r.level == LogLevel::ERROR) ? err : out;
+            time_formatter.append(line, r.time_ns);
+            line += levelPrefix(r.level);
+            line += " - ";
+            line.append(r.text, r.length);
+            line += '\n';
+        }
+        if (drops != reported_drops)
+        {
+            auto now = std::chrono::system_clock::now().time_since_epoch();
+            time_formatter.append(err, std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+            err += "[ERROR] - Logger: " + std::to_string(drops - reported_drops) + " record(s) dropped (ring full)\n";
+            reported_drops = drops;
+        }
+        writeAll(STDOUT_FILENO, out);
+        writeAll(STDERR_FILENO, err);
+    }
+}
+} // namespace
+
 bool Logger::isDebugEnabled()
 {
     return currentLevel >= LogLevel::DEBUG;
@@ -19,23 +227,88 @@ void Logger::setLevel(LogLevel level)
 
 void Logger::error(const std::string &msg)
 {
-    log("[ERROR]", msg, LogLevel::ERROR);
+    log(LogLevel::ERROR, msg.data(), msg.size());
 }
 
 void Logger::info(const std::string &msg)
 {
-    log("[INFO]", msg, LogLevel::INFO);
+    log(LogLevel::INFO, msg.data(), msg.size());
 }
 
 void Logger::debug(const std::string &msg)
 {
-    log("[DEBUG]", msg, LogLevel::DEBUG);
+    log(LogLevel::DEBUG, msg.data(), msg.size());
+}
+
+void Logger::logf(LogLevel level, const char *format, ...)
+{
+    if (level > currentLevel)
+        return;
+    char line[LOGF_LINE_BYTES];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (n < 0)
+        return;
+    log(level, line, std::min(static_cast<size_t>(n), sizeof(line) - 1));
+}
+
+void Logger::startAsync(size_t records)
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (writer_running.load(std::memory_order_relaxed))
+        return;
+    ring_records = records > 0 ? records : DEFAULT_ASYNC_RING_RECORDS;
+    async_generation.fetch_add(1, std::memory_order_acq_rel);
+    // Flush what the synchronous path buffered: the writer uses write() directly
+    std::cout << std::flush;
+    std::cerr << std::flush;
+    writer_running.store(true, std::memory_order_release);
+    writer = std::thread(writerLoop);
+    async_enabled.store(true, std::memory_order_release);
+}
+
+void Logger::stopAsync()
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (!writer_running.load(std::memory_order_relaxed))
+        return;
+    async_enabled.store(false, std::memory_order_release);
+    writer_running.store(false, std::memory_order_release);
+    writer.join();
+    std::lock_guard<std::mutex> rings_lock(rings_mutex);
+    rings.clear();
+}
+
+bool Logger::isAsync()
+{
+    return async_enabled.load(std::memory_order_acquire);
 }
 
-void Logger::log(const std::string &prefix, const std::string &msg, LogLevel level)
+uint64_t Logger::droppedRecords()
+{
+    return dropped_records.load(std::memory_order_relaxed);
+}
+
+void Logger::log(LogLevel level, const char *msg, size_t length)
 {
     if (level > currentLevel)
         return;
+
+    if (async_enabled.load(std::memory_order_acquire))
+    {
+        // Hot path: copy into this thread's ring, no lock and no formatting
+        LogRecord record;
+        record.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        record.level = level;
+        record.length = static_cast<uint16_t>(std::min(length, sizeof(record.text)));
+        memcpy(record.text, msg, record.length);
+        if (!threadRing().queue.tryPush(std::move(record)))
+            dropped_records.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
     std::lock_guard<std::mutex> lock(logMutex);
 
     // Get current time with milliseconds
@@ -51,7 +324,8 @@ void Logger::log(const std::string &prefix, const std::string &msg, LogLevel lev
     // Compose log line (no file/line info)
     std::ostringstream oss;
     oss << "[" << timebuf << "," << std::setfill('0') << std::setw(3) << ms.count() << "] "
-        << prefix << " - " << msg;
+        << levelPrefix(level) << " - ";
+    oss.write(msg, static_cast<std::streamsize>(length));
 
     if (level == LogLevel::ERROR)
     {
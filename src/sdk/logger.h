@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <mutex>
@@ -10,11 +12,46 @@ enum class LogLevel
     DEBUG
 };
 
+// Compile-time minimum level: FSL_LOG_* calls above FSL_LOG_MIN_LEVEL compile to nothing
+// (set by CMake: INFO for release builds, DEBUG otherwise). Values follow LogLevel.
+#define FSL_LOG_LEVEL_ERROR 0
+#define FSL_LOG_LEVEL_INFO 1
+#define FSL_LOG_LEVEL_DEBUG 2
+#ifndef FSL_LOG_MIN_LEVEL
+#define FSL_LOG_MIN_LEVEL FSL_LOG_LEVEL_DEBUG
+#endif
+
+// Lazy printf-style logging for hot paths: the arguments are only evaluated and formatted
+// once both the compile-time and the runtime level allow the message, e.g.
+//   FSL_LOG_DEBUG("Routed UDS->UDP: bytes=%zd, server '%s'", sent, name.c_str());
+#define FSL_LOG(level, ...)                                                                     \
+    do                                                                                          \
+    {                                                                                           \
+        if (static_cast<int>(level) <= FSL_LOG_MIN_LEVEL && Logger::isEnabled(level))           \
+            Logger::logf(level, __VA_ARGS__);                                                   \
+    } while (0)
+#define FSL_LOG_ERROR(...) FSL_LOG(LogLevel::ERROR, __VA_ARGS__)
+#define FSL_LOG_INFO(...) FSL_LOG(LogLevel::INFO, __VA_ARGS__)
+#define FSL_LOG_DEBUG(...) FSL_LOG(LogLevel::DEBUG, __VA_ARGS__)
+
 // Logger: Thread-safe logging utility
 // Usage: Logger::setLevel(), Logger::error(), Logger::info(), Logger::debug()
+//
+// By default every call formats and writes its line under a mutex. After startAsync(),
+// a call only copies the message into a lock-free ring owned by the calling thread; a
+// background writer thread timestamps, formats and writes the records in batches (merged
+// in time order across threads). A full ring drops the record and counts it
+// (droppedRecords()), so logging never blocks a forwarding thread. Messages longer than
+// ASYNC_TEXT_BYTES are truncated in async mode.
 class Logger
 {
 public:
+    // Default ring size (records per logging thread) and the longest async message
+    static constexpr size_t DEFAULT_ASYNC_RING_RECORDS = 256;
+    static constexpr size_t ASYNC_TEXT_BYTES = 500;
+    // Longest line formatted by logf()
+    static constexpr size_t LOGF_LINE_BYTES = 1024;
+
     // Set the global logging level
     static void setLevel(LogLevel level);
 
@@ -30,9 +67,33 @@ public:
     // Returns true if debug logging is enabled
     static bool isDebugEnabled();
 
+    // Returns true if messages of this level are logged (runtime level only)
+    static bool isEnabled(LogLevel level)
+    {
+        return level <= currentLevel;
+    }
+
+    // Format and log a message (printf format); use the FSL_LOG_* macros, which skip the
+    // call entirely when the level is disabled. Lines longer than LOGF_LINE_BYTES are truncated
+    static void logf(LogLevel level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    // Start the background writer; each thread's ring holds ring_records records
+    // (allocated on the thread's first log call)
+    static void startAsync(size_t ring_records = DEFAULT_ASYNC_RING_RECORDS);
+
+    // Write everything queued, stop the writer and return to synchronous logging
+    // Call after the threads that log have stopped (a record racing with it may be lost)
+    static void stopAsync();
+
+    // True while the background writer is running
+    static bool isAsync();
+
+    // Number of records dropped because a thread's ring was full
+    static uint64_t droppedRecords();
+
 private:
     static LogLevel currentLevel;
     static std::mutex logMutex;
-    // Internal log function
-    static void log(const std::string &prefix, const std::string &msg, LogLevel level);
+    // Internal log function (prefix is derived from level)
+    static void log(LogLevel level, const char *msg, size_t length);
 };
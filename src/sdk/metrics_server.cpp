@@ -0,0 +1,285 @@
+// metrics_server.cpp - Implementation of MetricsServer and OpenMetricsText
+//
+// The serving thread polls the listening sockets and an eventfd written by stop(). Each
+// connection is read up to the end of the request headers (or MAX_REQUEST_BYTES), answered
+// with HTTP/1.1 and "Connection: close", and closed; SO_RCVTIMEO/SO_SNDTIMEO bound how long
+// a slow or stuck client can hold the thread.
+
+#include "metrics_server.h"
+#include "logger.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+void OpenMetricsText::family(const std::string &name, const char *type, const char *help)
+{
+    text_ += "# TYPE " + name + " " + type + "\n";
+    text_ += "# HELP " + name + " " + help + "\n";
+}
+
+void OpenMetricsText::appendName(const std::string &name, const std::string &labels)
+{
+    text_ += name;
+    if (!labels.empty())
+        text_ += "{" + labels + "}";
+    text_ += ' ';
+}
+
+void OpenMetricsText::sample(const std::string &name, const std::string &labels, uint64_t value)
+{
+    appendName(name, labels);
+    text_ += std::to_string(value);
+    text_ += '\n';
+}
+
+void OpenMetricsText::sample(const std::string &name, const std::string &labels, double value)
+{
+    appendName(name, labels);
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.9g", value);
+    text_ += buf;
+    text_ += '\n';
+}
+
+std::string OpenMetricsText::labels(std::initializer_list<std::pair<const char *, std::string>> pairs)
+{
+    std::string out;
+    for (const auto &pair : pairs)
+    {
+        if (!out.empty())
+            out += ',';
+        out += pair.first;
+        out += "=\"";
+        for (char c : pair.second)
+        {
+            if (c == '\\' || c == '"')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if (c == '\n')
+                out += "\\n";
+            else
+                out += c;
+        }
+        out += '"';
+    }
+    return out;
+}
+
+std::string OpenMetricsText::finish()
+{
+    text_ += "# EOF\n";
+    return std::move(text_);
+}
+
+namespace
+{
+void setIoTimeout(int fd, int timeout_ms)
+{
+    timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+void sendAll(int fd, const std::string &text)
+{
+    size_t done = 0;
+    while (done < text.size())
+    {
+        ssize_t n = ::send(fd, text.data() + done, text.size() - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return; // client gone or timed out
+        done += static_cast<size_t>(n);
+    }
+}
+
+std::string httpResponse(const char *status, const char *content_type, const std::string &body)
+{
+    return std::string("HTTP/1.1 ") + status + "\r\nContent-Type: " + content_type +
+           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+}
+} // namespace
+
+MetricsServer::MetricsServer(std::string uds_path, int tcp_port, Renderer render)
+    : uds_path_(std::move(uds_path)), tcp_port_(tcp_port), render_(std::move(render))
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool MetricsServer::start(std::string &error)
+{
+    if (thread_.joinable())
+        return true;
+
+    if (!uds_path_.empty())
+    {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (uds_path_.size() >= sizeof(addr.sun_path))
+        {
+            error = "metrics UDS path too long: " + uds_path_;
+            return false;
+        }
+        strncpy(addr.sun_path, uds_path_.c_str(), sizeof(addr.sun_path) - 1);
+        uds_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        unlink(uds_path_.c_str()); // stale socket of a previous run
+        if (uds_fd_ < 0 || bind(uds_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(uds_fd_, 8) < 0)
+        {
+            error = "metrics UDS " + uds_path_ + ": " + strerror(errno);
+            closeSockets();
+            return false;
+        }
+    }
+
+    if (tcp_port_ > 0)
+    {
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(tcp_port_));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int one = 1;
+        tcp_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (tcp_fd_ < 0 || setsockopt(tcp_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+            bind(tcp_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(tcp_fd_, 8) < 0)
+        {
+            error = "metrics TCP port " + std::to_string(tcp_port_) + ": " + strerror(errno);
+            closeSockets();
+            return false;
+        }
+    }
+
+    stop_event_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (stop_event_fd_ < 0)
+    {
+        error = std::string("metrics eventfd: ") + strerror(errno);
+        closeSockets();
+        return false;
+    }
+    thread_ = std::thread(&MetricsServer::serve, this);
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    if (thread_.joinable())
+    {
+        uint64_t one = 1;
+        if (write(stop_event_fd_, &one, sizeof(one)) < 0)
+            Logger::error(std::string("Failed to stop the metrics server: ") + strerror(errno));
+        thread_.join();
+    }
+    closeSockets();
+}
+
+uint64_t MetricsServer::requests() const
+{
+    return requests_.load(std::memory_order_relaxed);
+}
+
+void MetricsServer::closeSockets()
+{
+    if (uds_fd_ >= 0)
+    {
+        close(uds_fd_);
+        unlink(uds_path_.c_str());
+        uds_fd_ = -1;
+    }
+    if (tcp_fd_ >= 0)
+    {
+        close(tcp_fd_);
+        tcp_fd_ = -1;
+    }
+    if (stop_event_fd_ >= 0)
+    {
+        close(stop_event_fd_);
+        stop_event_fd_ = -1;
+    }
+}
+
+void MetricsServer::serve()
+{
+    pollfd fds[3];
+    nfds_t count = 0;
+    fds[count++] = {stop_event_fd_, POLLIN, 0};
+    if (uds_fd_ >= 0)
+        fds[count++] = {uds_fd_, POLLIN, 0};
+    if (tcp_fd_ >= 0)
+        fds[count++] = {tcp_fd_, POLLIN, 0};
+
+    for (;;)
+    {
+        if (poll(fds, count, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            Logger::error(std::string("Metrics server poll failed: ") + strerror(errno));
+            return;
+        }
+        if (fds[0].revents)
+            return;
+        for (nfds_t i = 1; i < count; ++i)
+        {
+            if (!(fds[i].revents & POLLIN))
+                continue;
+            int fd = accept4(fds[i].fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0)
+                continue; // client gave up, or out of fds: retried on the next wakeup
+            setIoTimeout(fd, IO_TIMEOUT_MS);
+            handleConnection(fd);
+            close(fd);
+        }
+    }
+}
+
+void MetricsServer::handleConnection(int fd)
+{
+    std::string request;
+    char buf[512];
+    while (request.size() < MAX_REQUEST_BYTES && request.find("\r\n\r\n") == std::string::npos)
+    {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break; // EOF or timeout: answer what was received
+        request.append(buf, static_cast<size_t>(n));
+    }
+
+    // Request line: METHOD SP PATH SP VERSION
+    size_t method_end = request.find(' ');
+    size_t path_end = method_end == std::string::npos ? std::string::npos : request.find_first_of(" ?\r\n", method_end + 1);
+    if (path_end == std::string::npos)
+    {
+        sendAll(fd, httpResponse("400 Bad Request", "text/plain", "Bad request\n"));
+        return;
+    }
+    std::string method = request.substr(0, method_end);
+    std::string path = request.substr(method_end + 1, path_end - method_end - 1);
+    if (method != "GET")
+        sendAll(fd, httpResponse("405 Method Not Allowed", "text/plain", "Only GET is supported\n"));
+    else if (path != "/metrics" && path != "/")
+        sendAll(fd, httpResponse("404 Not Found", "text/plain", "Not found, try /metrics\n"));
+    else
+    {
+        sendAll(fd, httpResponse("200 OK", CONTENT_TYPE, render_()));
+        requests_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,91 @@
+// metrics_server.h - OpenMetrics text exposition over a local socket
+//
+// MetricsServer answers HTTP GET /metrics on a Unix stream socket and/or a loopback TCP
+// port with the text produced by a render callback, so a Prometheus scraper (or
+// `curl --unix-socket`) can read FSL's counters. It runs in its own thread: connections
+// are served one at a time with bounded timeouts, and the callback only reads counters
+// the forwarding threads update with relaxed atomics, so a scrape never blocks them.
+//
+// OpenMetricsText builds the exposition text: one family (TYPE/HELP lines) followed by its
+// samples, terminated by "# EOF".
+//
+// Usage:
+//   - MetricsServer server("/tmp/fsl_metrics", 0, [&] { return renderMetrics(); });
+//   - server.start(error) once; server.stop() (or the destructor) joins the thread
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <utility>
+
+// OpenMetricsText: OpenMetrics 1.0 text format writer
+class OpenMetricsText
+{
+public:
+    // Start a family; type is "counter", "gauge" or "histogram" (samples of a counter
+    // family are named name + "_total")
+    void family(const std::string &name, const char *type, const char *help);
+
+    // One sample; labels from labels() (empty = none)
+    void sample(const std::string &name, const std::string &labels, uint64_t value);
+    void sample(const std::string &name, const std::string &labels, double value);
+
+    // Label set text (key="value",...) with the values escaped
+    static std::string labels(std::initializer_list<std::pair<const char *, std::string>> pairs);
+
+    // Terminate the exposition ("# EOF") and return it
+    std::string finish();
+
+private:
+    void appendName(const std::string &name, const std::string &labels);
+
+    std::string text_;
+};
+
+// MetricsServer: serves the rendered text to HTTP GET requests on a UDS and/or loopback TCP
+class MetricsServer
+{
+public:
+    using Renderer = std::function<std::string()>;
+
+    // Content type of the response (OpenMetrics; Prometheus also accepts it)
+    static constexpr const char *CONTENT_TYPE = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    // Longest request read (request line and headers) and the per-connection I/O timeout
+    static constexpr size_t MAX_REQUEST_BYTES = 4096;
+    static constexpr int IO_TIMEOUT_MS = 1000;
+
+    // uds_path: Unix stream socket path (empty = none); tcp_port: 127.0.0.1 port (0 = none)
+    MetricsServer(std::string uds_path, int tcp_port, Renderer render);
+    ~MetricsServer(); // stop()
+
+    MetricsServer(const MetricsServer &) = delete;
+    MetricsServer &operator=(const MetricsServer &) = delete;
+
+    // Open the listening sockets and start the serving thread
+    // Returns false with the reason in error (nothing is left open)
+    bool start(std::string &error);
+
+    // Stop the serving thread, close the sockets and unlink the UDS path
+    void stop();
+
+    // Number of requests answered
+    uint64_t requests() const;
+
+private:
+    void serve();
+    void handleConnection(int fd);
+    void closeSockets();
+
+    const std::string uds_path_;
+    const int tcp_port_;
+    Renderer render_;
+    int uds_fd_ = -1;
+    int tcp_fd_ = -1;
+    int stop_event_fd_ = -1;
+    std::thread thread_;
+    std::atomic<uint64_t> requests_{0};
+};
@@ -0,0 +1,112 @@
+// mpsc_queue.h - Bounded lock-free multi-producer, single-consumer queue
+//
+// MpscQueue<T> keeps capacity preallocated slots in a ring. Each slot carries a sequence
+// number that tells producers and the consumer whose turn it is (Vyukov's bounded queue):
+// a producer claims a position with one compare-exchange on the tail, moves its value in
+// and publishes the slot; the consumer takes slots in order from the head. Neither side
+// takes a lock or allocates, and a full queue is reported to the producer immediately.
+//
+// The queue does not block. A consumer that sleeps pairs it with a wakeup (e.g. an
+// eventfd written after tryPush() succeeds) and drains with tryPop() when woken.
+//
+// Usage:
+//   - MpscQueue<CtrlRequest> queue(capacity)
+//   - producers: if (!queue.tryPush(std::move(req))) handle "queue full"
+//   - consumer:  while (queue.tryPop(req)) process(req)
+//   - size(): current depth (approximate while producers are active)
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+template <typename T>
+class MpscQueue
+{
+public:
+    // Constructor: preallocate capacity slots (throws std::invalid_argument if 0)
+    explicit MpscQueue(size_t capacity)
+        : capacity_(capacity), slots_(capacity ? new Slot[capacity] : nullptr), head_(0), tail_(0)
+    {
+        if (capacity == 0)
+            throw std::invalid_argument("MpscQueue: capacity must be > 0");
+        for (size_t i = 0; i < capacity; ++i)
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    // Append value (any thread). Returns false, leaving value untouched, if the queue is full
+    bool tryPush(T &&value)
+    {
+        uint64_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Slot &slot = slots_[pos % capacity_];
+            uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == pos)
+            {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.value = std::move(value);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < pos)
+            {
+                return false; // slot still holds the value from one lap ago: full
+            }
+            else
+            {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Take the oldest value (consumer thread only). Returns false if the queue is empty
+    // or the oldest slot is still being written by its producer
+    bool tryPop(T &value)
+    {
+        uint64_t pos = head_.load(std::memory_order_relaxed);
+        Slot &slot = slots_[pos % capacity_];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+            return false;
+        value = std::move(slot.value);
+        slot.value = T();
+        head_.store(pos + 1, std::memory_order_relaxed);
+        slot.sequence.store(pos + capacity_, std::memory_order_release);
+        return true;
+    }
+
+    // Number of queued values
+    size_t size() const
+    {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        return tail > head ? static_cast<size_t>(tail - head) : 0;
+    }
+
+    // Maximum number of queued values
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        T value;
+    };
+
+    const size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+    // Consumer and producer positions on separate cache lines
+    alignas(64) std::atomic<uint64_t> head_;
+    alignas(64) std::atomic<uint64_t> tail_;
+};
@@ -0,0 +1,190 @@
+// msg_batch.cpp - Implementation of MsgBatch
+//
+// Own buffers live in one contiguous allocation (8-byte aligned); pool buffers are
+// wherever the pool handed them out.
+// prepare() must be called before every recvmmsg() because the kernel updates
+// msg_len/msg_flags in place.
+
+#include "msg_batch.h"
+#include <cstring>
+#include <ctime>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <stdexcept>
+#include <string>
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+// Ancillary data per datagram: UDP_GRO segment size, SCM_TIMESTAMPNS receive time
+static constexpr size_t SEGMENT_CONTROL_SPACE = CMSG_SPACE(sizeof(int));
+static constexpr size_t TIMESTAMP_CONTROL_SPACE = CMSG_SPACE(sizeof(timespec));
+
+MsgBatch::MsgBatch(size_t count, size_t buffer_size)
+    : buffer_size_(buffer_size), size_(0), control_space_(0), segment_info_(false), timestamps_(false)
+{
+    if (count == 0 || count > MAX_COUNT)
+        throw std::runtime_error("MsgBatch: invalid batch size " + std::to_string(count));
+    if (buffer_size == 0)
+        throw std::runtime_error("MsgBatch: invalid buffer size");
+
+    size_t stride = (buffer_size + 7) & ~static_cast<size_t>(7);
+    storage_.resize(count * stride);
+    for (size_t i = 0; i < count; ++i)
+        slots_.push_back(storage_.data() + i * stride);
+    init(count);
+}
+
+MsgBatch::MsgBatch(BufferPool &pool, size_t count, size_t buffer_size)
+    : buffer_size_(buffer_size), size_(0), control_space_(0), segment_info_(false), timestamps_(false)
+{
+    if (count == 0 || count > MAX_COUNT)
+        throw std::runtime_error("MsgBatch: invalid batch size " + std::to_string(count));
+    if (buffer_size == 0 || buffer_size > pool.bufferSize())
+        throw std::runtime_error("MsgBatch: invalid buffer size");
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        PoolBuffer buffer = pool.acquire();
+        if (!buffer)
+            throw std::runtime_error("MsgBatch: buffer pool exhausted");
+        slots_.push_back(buffer.data());
+        pool_buffers_.push_back(std::move(buffer));
+    }
+    init(count);
+}
+
+void MsgBatch::init(size_t count)
+{
+    iovecs_.resize(count);
+    addrs_.resize(count);
+    msgs_.resize(count);
+    memset(msgs_.data(), 0, msgs_.size() * sizeof(mmsghdr));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        iovecs_[i].iov_base = data(i);
+        iovecs_[i].iov_len = buffer_size_;
+        msgs_[i].msg_hdr.msg_iov = &iovecs_[i];
+        msgs_[i].msg_hdr.msg_iovlen = 1;
+        msgs_[i].msg_hdr.msg_name = &addrs_[i];
+    }
+}
+
+size_t MsgBatch::capacity() const
+{
+    return msgs_.size();
+}
+
+size_t MsgBatch::bufferSize() const
+{
+    return buffer_size_;
+}
+
+size_t MsgBatch::size() const
+{
+    return size_;
+}
+
+uint8_t *MsgBatch::data(size_t i)
+{
+    return slots_[i];
+}
+
+size_t MsgBatch::length(size_t i) const
+{
+    return msgs_[i].msg_len;
+}
+
+bool MsgBatch::truncated(size_t i) const
+{
+    return (msgs_[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+}
+
+const sockaddr_storage &MsgBatch::senderAddr(size_t i) const
+{
+    return addrs_[i];
+}
+
+void MsgBatch::enableSegmentInfo()
+{
+    segment_info_ = true;
+    allocateControl();
+}
+
+void MsgBatch::enableTimestamps()
+{
+    timestamps_ = true;
+    allocateControl();
+}
+
+void MsgBatch::allocateControl()
+{
+    control_space_ = (segment_info_ ? SEGMENT_CONTROL_SPACE : 0) + (timestamps_ ? TIMESTAMP_CONTROL_SPACE : 0);
+    control_.assign(msgs_.size() * control_space_, 0);
+    for (size_t i = 0; i < msgs_.size(); ++i)
+    {
+        msgs_[i].msg_hdr.msg_control = &control_[i * control_space_];
+        msgs_[i].msg_hdr.msg_controllen = control_space_;
+    }
+}
+
+size_t MsgBatch::segmentSize(size_t i) const
+{
+    if (!segment_info_)
+        return 0;
+    msghdr &hdr = const_cast<msghdr &>(msgs_[i].msg_hdr);
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+        {
+            int segment_size;
+            memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+            return segment_size > 0 && static_cast<size_t>(segment_size) < msgs_[i].msg_len ? segment_size : 0;
+        }
+    }
+    return 0;
+}
+
+int64_t MsgBatch::receiveTimeNs(size_t i) const
+{
+    if (!timestamps_)
+        return 0;
+    return timestampNs(msgs_[i].msg_hdr);
+}
+
+int64_t MsgBatch::timestampNs(const msghdr &hdr)
+{
+    msghdr &h = const_cast<msghdr &>(hdr);
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&h); cmsg != nullptr; cmsg = CMSG_NXTHDR(&h, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+    }
+    return 0;
+}
+
+mmsghdr *MsgBatch::prepare()
+{
+    for (size_t i = 0; i < msgs_.size(); ++i)
+    {
+        msgs_[i].msg_len = 0;
+        msgs_[i].msg_hdr.msg_flags = 0;
+        msgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+        addrs_[i].ss_family = AF_UNSPEC;
+        if (!control_.empty())
+            msgs_[i].msg_hdr.msg_controllen = control_space_;
+    }
+    size_ = 0;
+    return msgs_.data();
+}
+
+void MsgBatch::setSize(size_t n)
+{
+    size_ = n;
+}
@@ -0,0 +1,100 @@
+// msg_batch.h - Preallocated datagram batch for recvmmsg()
+//
+// MsgBatch owns a fixed number of equally sized receive buffers together with the
+// mmsghdr/iovec/address arrays needed to fill all of them with a single recvmmsg() call.
+// All memory is allocated once at construction, so receiving a batch performs no
+// heap allocation. The buffers can instead be drawn from a BufferPool, which then
+// accounts for them for the lifetime of the batch.
+//
+// With enableSegmentInfo() every datagram also gets a small control buffer, so a
+// UDP socket with UDP_GRO can report the segment size of coalesced datagrams
+// (segmentSize()). enableTimestamps() adds room for the kernel receive timestamp of a
+// socket with SO_TIMESTAMPNS (receiveTimeNs()).
+//
+// Usage:
+//   - MsgBatch batch(count, buffer_size), or MsgBatch batch(pool, count, buffer_size)
+//   - int n = socket.receiveBatch(batch)
+//   - for (int i = 0; i < n; ++i) process(batch.data(i), batch.length(i))
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "buffer_pool.h"
+
+// MsgBatch: fixed set of receive buffers for batched datagram reads
+class MsgBatch
+{
+public:
+    // Maximum number of datagrams per batch (kernel UIO_MAXIOV limit for recvmmsg)
+    static constexpr size_t MAX_COUNT = 1024;
+
+    // Constructor: allocate count buffers of buffer_size bytes each
+    MsgBatch(size_t count, size_t buffer_size);
+
+    // Constructor: take count buffers from pool (buffer_size must fit in one pool buffer;
+    // throws std::runtime_error if the pool is exhausted)
+    MsgBatch(BufferPool &pool, size_t count, size_t buffer_size);
+
+    // Number of buffers (maximum datagrams per receive)
+    size_t capacity() const;
+
+    // Size of each buffer in bytes
+    size_t bufferSize() const;
+
+    // Number of datagrams filled by the last receive
+    size_t size() const;
+
+    // Start of buffer i
+    uint8_t *data(size_t i);
+
+    // Length of datagram i (valid for i < size())
+    size_t length(size_t i) const;
+
+    // True if datagram i did not fit in its buffer and was truncated
+    bool truncated(size_t i) const;
+
+    // Sender address of datagram i (family AF_UNSPEC if the sender is unnamed)
+    const sockaddr_storage &senderAddr(size_t i) const;
+
+    // Receive ancillary data with every datagram, needed for segmentSize()
+    void enableSegmentInfo();
+
+    // If datagram i holds several coalesced datagrams (UDP GRO): size of each of them
+    // (the last one may be shorter). 0 if it is a single datagram
+    size_t segmentSize(size_t i) const;
+
+    // Receive ancillary data with every datagram, needed for receiveTimeNs()
+    void enableTimestamps();
+
+    // Kernel receive time of datagram i (CLOCK_REALTIME ns), 0 if the socket did not report it
+    int64_t receiveTimeNs(size_t i) const;
+
+    // SCM_TIMESTAMPNS time carried by hdr's ancillary data (CLOCK_REALTIME ns), 0 if none
+    static int64_t timestampNs(const msghdr &hdr);
+
+    // Reset headers before a receive call and return the mmsghdr array (for socket wrappers)
+    mmsghdr *prepare();
+
+    // Record the number of datagrams filled by the last receive (for socket wrappers)
+    void setSize(size_t n);
+
+private:
+    void init(size_t count);
+    void allocateControl();
+
+    size_t buffer_size_;
+    size_t size_;
+    std::vector<uint8_t> storage_;        // own buffers (when not drawn from a pool)
+    std::vector<PoolBuffer> pool_buffers_; // pool buffers (when drawn from a pool)
+    std::vector<uint8_t *> slots_;        // start of buffer i
+    std::vector<iovec> iovecs_;
+    std::vector<sockaddr_storage> addrs_;
+    std::vector<mmsghdr> msgs_;
+    std::vector<uint8_t> control_; // per-datagram ancillary data (enableSegmentInfo(), enableTimestamps())
+    size_t control_space_;         // control_ bytes per datagram
+    bool segment_info_;
+    bool timestamps_;
+};
@@ -0,0 +1,129 @@
+// realtime.cpp - Implementation of thread profiles and memory locking
+
+#include "realtime.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+namespace
+{
+// Stack prefaulted by lockMemory(): deeper than any call chain on the forwarding path
+constexpr size_t STACK_PREFAULT_BYTES = 256 * 1024;
+
+void prefaultStack()
+{
+    volatile unsigned char stack[STACK_PREFAULT_BYTES];
+    for (size_t i = 0; i < sizeof(stack); i += 4096)
+        stack[i] = 0;
+}
+} // namespace
+
+bool parseCpuList(const std::string &text, std::vector<int> &cpus)
+{
+    cpus.clear();
+    if (text.empty())
+        return true;
+    size_t pos = 0;
+    while (pos <= text.size())
+    {
+        size_t end = text.find(',', pos);
+        if (end == std::string::npos)
+            end = text.size();
+        std::string item = text.substr(pos, end - pos);
+        pos = end + 1;
+
+        char *rest = nullptr;
+        long first = strtol(item.c_str(), &rest, 10);
+        long last = first;
+        if (rest == item.c_str())
+            return false;
+        if (*rest == '-')
+        {
+            const char *range = rest + 1;
+            last = strtol(range, &rest, 10);
+            if (rest == range)
+                return false;
+        }
+        if (*rest != '\0' || first < 0 || last < first || last >= CPU_SETSIZE)
+            return false;
+        for (long cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(static_cast<int>(cpu));
+    }
+    return true;
+}
+
+bool parseSchedPolicy(const std::string &name, int &policy)
+{
+    if (name == "other")
+        policy = SCHED_OTHER;
+    else if (name == "fifo")
+        policy = SCHED_FIFO;
+    else if (name == "rr")
+        policy = SCHED_RR;
+    else
+        return false;
+    return true;
+}
+
+bool schedPriorityRange(const std::string &name, int &min_priority, int &max_priority)
+{
+    int policy;
+    if (!parseSchedPolicy(name, policy))
+        return false;
+    min_priority = sched_get_priority_min(policy);
+    max_priority = sched_get_priority_max(policy);
+    return min_priority >= 0 && max_priority >= min_priority;
+}
+
+bool applyThreadProfile(const std::string &cpus, const std::string &policy, int priority, std::string &error)
+{
+    std::vector<int> cpu_list;
+    int sched_policy;
+    if (!parseCpuList(cpus, cpu_list) || !parseSchedPolicy(policy, sched_policy))
+    {
+        error = "invalid CPU list or policy";
+        return false;
+    }
+
+    if (!cpu_list.empty())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpu_list)
+            CPU_SET(cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0)
+        {
+            error = std::string("CPU affinity ") + cpus + ": " + strerror(err);
+            return false;
+        }
+    }
+
+    if (sched_policy != SCHED_OTHER || priority != 0)
+    {
+        sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = priority;
+        int err = pthread_setschedparam(pthread_self(), sched_policy, &param);
+        if (err != 0)
+        {
+            error = "scheduling " + policy + "/" + std::to_string(priority) + ": " + strerror(err);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool lockMemory(std::string &error)
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+    {
+        error = std::string("mlockall: ") + strerror(errno);
+        return false;
+    }
+    prefaultStack();
+    return true;
+}
@@ -0,0 +1,37 @@
+// realtime.h - CPU affinity, real-time scheduling and memory locking for FSL threads
+//
+// A thread profile pins the calling thread to a set of CPUs and selects its scheduling
+// policy: SCHED_OTHER (default time sharing), SCHED_FIFO or SCHED_RR with a static
+// priority. lockMemory() keeps every page of the process resident (mlockall) so page
+// faults never land on the forwarding path.
+//
+// Usage:
+//   - parseCpuList("0-1,3", cpus), parseSchedPolicy("fifo", policy): validate config values
+//   - applyThreadProfile(cpus, policy, priority, error): from the thread to configure
+//   - lockMemory(error): once at startup, before the worker threads are started
+//
+// Real-time policies and mlockall() need CAP_SYS_NICE / CAP_IPC_LOCK (or matching
+// rlimits); on failure the functions return false with the reason in error.
+
+#pragma once
+#include <string>
+#include <vector>
+
+// Parse a CPU list ("2", "0-3", "0,2-3"); an empty string is an empty list
+// Returns false if the text is malformed
+bool parseCpuList(const std::string &text, std::vector<int> &cpus);
+
+// Parse a scheduling policy name: "other", "fifo" or "rr" (SCHED_* value in policy)
+bool parseSchedPolicy(const std::string &name, int &policy);
+
+// Valid priority range of a policy (0..0 for "other", 1..99 for "fifo"/"rr" on Linux)
+bool schedPriorityRange(const std::string &name, int &min_priority, int &max_priority);
+
+// Pin the calling thread to cpus (empty = leave affinity unchanged) and set its policy and
+// priority ("other" with priority 0 leaves scheduling unchanged)
+// Returns false with the reason in error if the kernel refuses
+bool applyThreadProfile(const std::string &cpus, const std::string &policy, int priority, std::string &error);
+
+// Lock current and future pages in memory and prefault the calling thread's stack
+// Returns false with the reason in error if mlockall() fails
+bool lockMemory(std::string &error);
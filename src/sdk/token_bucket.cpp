@@ -0,0 +1,71 @@
+// token_bucket.cpp - Implementation of TokenBucket
+//
+// full_at_ns_ - now is the debt in time: bytes sent beyond what the rate has paid for.
+// A datagram conforms if, after charging it, the debt does not exceed the burst time.
+
+#include "token_bucket.h"
+#include <algorithm>
+#include <chrono>
+
+TokenBucket::TokenBucket(uint64_t rate_bps, uint64_t burst_bytes)
+    : rate_bps_(0), burst_bytes_(0), full_at_ns_(0)
+{
+    configure(rate_bps, burst_bytes);
+}
+
+void TokenBucket::configure(uint64_t rate_bps, uint64_t burst_bytes)
+{
+    burst_bytes_.store(std::min(burst_bytes, MAX_BURST_BYTES), std::memory_order_relaxed);
+    rate_bps_.store(std::min(rate_bps, MAX_RATE_BPS), std::memory_order_relaxed);
+    full_at_ns_.store(0, std::memory_order_relaxed);
+}
+
+bool TokenBucket::enabled() const
+{
+    return rate_bps_.load(std::memory_order_relaxed) != 0;
+}
+
+uint64_t TokenBucket::rateBps() const
+{
+    return rate_bps_.load(std::memory_order_relaxed);
+}
+
+uint64_t TokenBucket::burstBytes() const
+{
+    return burst_bytes_.load(std::memory_order_relaxed);
+}
+
+int64_t TokenBucket::costNs(uint64_t bytes, uint64_t rate_bps)
+{
+    // bits * 1e9 overflows for large bursts; split so both terms fit for rates up to MAX_RATE_BPS
+    const uint64_t bits = bytes * 8;
+    return static_cast<int64_t>(bits / rate_bps * 1000000000ull + bits % rate_bps * 1000000000ull / rate_bps);
+}
+
+int64_t TokenBucket::delayNs(size_t bytes, int64_t now_ns) const
+{
+    const uint64_t rate = rate_bps_.load(std::memory_order_relaxed);
+    if (rate == 0)
+        return 0;
+    const int64_t full_at = std::max(full_at_ns_.load(std::memory_order_relaxed), now_ns);
+    const int64_t burst_ns = std::max(costNs(burst_bytes_.load(std::memory_order_relaxed), rate), costNs(bytes, rate));
+    const int64_t over = full_at + costNs(bytes, rate) - now_ns - burst_ns;
+    return over > 0 ? over : 0;
+}
+
+void TokenBucket::consume(size_t bytes, int64_t now_ns)
+{
+    const uint64_t rate = rate_bps_.load(std::memory_order_relaxed);
+    if (rate == 0)
+        return;
+    const int64_t cost = costNs(bytes, rate);
+    int64_t full_at = full_at_ns_.load(std::memory_order_relaxed);
+    while (!full_at_ns_.compare_exchange_weak(full_at, std::max(full_at, now_ns) + cost, std::memory_order_relaxed))
+    {
+    }
+}
+
+int64_t TokenBucket::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
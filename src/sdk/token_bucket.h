@@ -0,0 +1,64 @@
+// token_bucket.h - Lock-free token-bucket rate limiter for the UDP downlink
+//
+// TokenBucket paces traffic to rate_bps bits per second while allowing bursts of up to
+// burst_bytes at line rate. Instead of a token count refilled by a timer, the bucket
+// keeps the time at which it will be full again (tokens owed, expressed in time): a
+// datagram conforms when charging it leaves no more than the burst outstanding. That
+// state is one atomic, so several egress threads can share one bucket for the same link
+// without a lock, and nothing ever sleeps: a non-conforming caller gets the time to wait
+// and retries later (e.g. as its poll() timeout).
+//
+// Rate and burst may be changed at any time from any thread (e.g. by a ctrl request);
+// the new values apply to the next datagram. A rate of 0 disables shaping.
+//
+// Usage:
+//   - TokenBucket bucket(rate_bps, burst_bytes)
+//   - int64_t now = TokenBucket::nowNs();
+//   - if (bucket.delayNs(bytes, now) == 0) { send; bucket.consume(bytes, now); }
+//   - bucket.configure(rate_bps, burst_bytes) from any thread
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class TokenBucket
+{
+public:
+    // Largest accepted rate and burst: keep the time arithmetic in ns inside 64 bits
+    static constexpr uint64_t MAX_RATE_BPS = 10000000000ull;
+    static constexpr uint64_t MAX_BURST_BYTES = 1ull << 30;
+
+    // Constructor: rate_bps bits per second (0 = unlimited), bucket depth burst_bytes
+    explicit TokenBucket(uint64_t rate_bps = 0, uint64_t burst_bytes = 0);
+
+    // Change rate and burst (any thread, clamped to the maximums); the bucket starts full
+    void configure(uint64_t rate_bps, uint64_t burst_bytes);
+
+    // True if a rate is set
+    bool enabled() const;
+
+    // Current settings
+    uint64_t rateBps() const;
+    uint64_t burstBytes() const;
+
+    // Nanoseconds until bytes more may be sent, 0 if they conform now
+    // A datagram larger than the burst conforms once the bucket is full
+    int64_t delayNs(size_t bytes, int64_t now_ns) const;
+
+    // Charge bytes that were sent (they may exceed what conformed, e.g. under a race
+    // between threads; the debt is paid back by later datagrams waiting longer)
+    void consume(size_t bytes, int64_t now_ns);
+
+    // steady_clock in nanoseconds
+    static int64_t nowNs();
+
+private:
+    // Time it takes to send bytes at rate_bps
+    static int64_t costNs(uint64_t bytes, uint64_t rate_bps);
+
+    std::atomic<uint64_t> rate_bps_;
+    std::atomic<uint64_t> burst_bytes_;
+    // Time at which the bucket is full again (<= now: full)
+    std::atomic<int64_t> full_at_ns_;
+};
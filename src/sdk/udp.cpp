@@ -4,12 +4,20 @@
 //
 // Key methods:
 //   - bindSocket(): Bind the socket to local_port_
+//   - connectRemote(): Connect the socket to remote_addr_
 //   - send(): Send a datagram to remote_addr_
+//   - sendv(): Send a datagram gathered from several segments with sendmsg()
+//   - sendBatch(): Send several datagrams to remote_addr_ with sendmmsg()
+//   - gsoSupported()/sendSegmented(): UDP GSO (sendmsg() with a UDP_SEGMENT cmsg)
+//   - enableGro(): UDP GRO (setsockopt UDP_GRO)
+//   - enableTimestamps(): Kernel receive timestamps (SO_TIMESTAMPNS)
 //   - receive(): Receive a datagram from the socket
+//   - receiveBatch(): Drain up to N datagrams per call using recvmmsg()
 //   - getFd(): Get the socket file descriptor
+//   - getRemoteAddr(): Get remote_addr_
 //
 // Error handling: Throws std::runtime_error on socket creation/binding errors.
-// Logs send/receive errors using perror.
+// Send/receive errors are reported through ErrorThrottle (first failure, then a summary per second).
 
 #include <arpa/inet.h>
 #include <fcntl.h>
@@ -18,11 +26,22 @@
 #include <cstring>
 #include <stdexcept>
 #include <netdb.h>
+#include <netinet/udp.h>
 #include <iostream>
 #include "udp.h"
 
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
 UdpServerSocket::UdpServerSocket(int local_port, const std::string &remote_ip, int remote_port)
-    : fd_(-1), local_port_(local_port), remote_ip_(remote_ip), remote_port_(remote_port)
+    : fd_(-1), local_port_(local_port), remote_ip_(remote_ip), remote_port_(remote_port),
+      send_full_errors_("UDP send failed", remote_ip + ":" + std::to_string(remote_port)),
+      send_errors_("UDP send failed", remote_ip + ":" + std::to_string(remote_port)),
+      receive_errors_("UDP receive failed", "port " + std::to_string(local_port))
 {
     memset(&local_addr_, 0, sizeof(local_addr_));
     local_addr_.sin_family = AF_INET;
@@ -83,19 +102,113 @@ bool UdpServerSocket::bindSocket()
     return true;
 }
 
+bool UdpServerSocket::connectRemote()
+{
+    if (connect(fd_, (struct sockaddr *)&remote_addr_, sizeof(remote_addr_)) < 0)
+        return false;
+    return true;
+}
+
+void UdpServerSocket::reportSendError()
+{
+    int saved_errno = errno;
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+        send_full_errors_.report(saved_errno);
+    else
+        send_errors_.report(saved_errno);
+    errno = saved_errno;
+}
+
+void UdpServerSocket::reportReceiveError()
+{
+    int saved_errno = errno;
+    receive_errors_.report(saved_errno);
+    errno = saved_errno;
+}
+
 ssize_t UdpServerSocket::send(const void *buffer, size_t length)
 {
     ssize_t sent = sendto(fd_, buffer, length, 0, (struct sockaddr *)&remote_addr_, sizeof(remote_addr_));
     if (sent < 0)
     {
-        if (errno == EAGAIN || errno == EWOULDBLOCK)
-        {
-            std::cerr << "[ERROR] UDP sendto failed: buffer full (EAGAIN/EWOULDBLOCK)\n";
-        }
-        else
-        {
-            perror("[ERROR] UDP sendto failed");
-        }
+        reportSendError();
+    }
+    return sent;
+}
+
+ssize_t UdpServerSocket::sendv(const iovec *iov, size_t iovcnt)
+{
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &remote_addr_;
+    msg.msg_namelen = sizeof(remote_addr_);
+    msg.msg_iov = const_cast<iovec *>(iov);
+    msg.msg_iovlen = iovcnt;
+
+    ssize_t sent = sendmsg(fd_, &msg, 0);
+    if (sent < 0)
+    {
+        reportSendError();
+    }
+    return sent;
+}
+
+// Kernels without GSO ignore an unknown SOL_UDP cmsg and would send one large
+// datagram, so support is probed with getsockopt() before sendSegmented() is used
+bool UdpServerSocket::gsoSupported() const
+{
+    int segment_size = 0;
+    socklen_t len = sizeof(segment_size);
+    return getsockopt(fd_, SOL_UDP, UDP_SEGMENT, &segment_size, &len) == 0;
+}
+
+ssize_t UdpServerSocket::sendSegmented(const iovec *iov, size_t iovcnt, uint16_t segment_size)
+{
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))];
+    memset(control, 0, sizeof(control));
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &remote_addr_;
+    msg.msg_namelen = sizeof(remote_addr_);
+    msg.msg_iov = const_cast<iovec *>(iov);
+    msg.msg_iovlen = iovcnt;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+
+    return sendmsg(fd_, &msg, 0);
+}
+
+bool UdpServerSocket::enableGro()
+{
+    int on = 1;
+    return setsockopt(fd_, SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0;
+}
+
+bool UdpServerSocket::enableTimestamps()
+{
+    int on = 1;
+    return setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0;
+}
+
+int UdpServerSocket::sendBatch(mmsghdr *msgs, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        msgs[i].msg_hdr.msg_name = &remote_addr_;
+        msgs[i].msg_hdr.msg_namelen = sizeof(remote_addr_);
+    }
+
+    int sent = sendmmsg(fd_, msgs, count, 0);
+    if (sent < 0)
+    {
+        reportSendError();
     }
     return sent;
 }
@@ -114,12 +227,32 @@ ssize_t UdpServerSocket::receive(void *buffer, size_t length, sockaddr_in *sende
     }
     if (received < 0)
     {
-        perror("[ERROR] UDP recvfrom failed");
+        reportReceiveError();
     }
     return received;
 }
 
+int UdpServerSocket::receiveBatch(MsgBatch &batch)
+{
+    mmsghdr *msgs = batch.prepare();
+    int received = recvmmsg(fd_, msgs, batch.capacity(), MSG_DONTWAIT, NULL);
+    if (received < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+        reportReceiveError();
+        return -1;
+    }
+    batch.setSize(received);
+    return received;
+}
+
 int UdpServerSocket::getFd() const
 {
     return fd_;
 }
+
+const sockaddr_in &UdpServerSocket::getRemoteAddr() const
+{
+    return remote_addr_;
+}
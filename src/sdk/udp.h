@@ -6,15 +6,28 @@
 // Usage:
 //   - UdpServerSocket(local_port, remote_ip, remote_port)
 //   - bindSocket(): Bind the socket to local_port
+//   - connectRemote(): Connect the socket to remote_ip:remote_port
 //   - send(): Send a datagram to remote_ip:remote_port
+//   - sendv(): Send one datagram gathered from several buffers (sendmsg() iovecs)
+//   - sendBatch(): Send several datagrams to remote_ip:remote_port with one sendmmsg() call
+//   - gsoSupported()/sendSegmented(): UDP GSO, one sendmsg() split into equally sized datagrams
+//   - enableGro(): UDP GRO, trains of equally sized datagrams received coalesced
+//   - enableTimestamps(): Kernel receive timestamps (SO_TIMESTAMPNS)
 //   - receive(): Receive a datagram from the socket
+//   - receiveBatch(): Receive up to N datagrams (with sender addresses) with one recvmmsg() call
 //   - getFd(): Get the socket file descriptor
+//   - getRemoteAddr(): Get the resolved remote_ip:remote_port address
 //
 // Error handling: Throws std::runtime_error on socket creation/binding errors.
 
 #pragma once
 #include <string>
+#include <cstdint>
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "error_throttle.h"
+#include "msg_batch.h"
 
 // UdpServerSocket: UDP socket wrapper
 class UdpServerSocket
@@ -29,15 +42,58 @@ public:
     // Bind the socket to local_port
     bool bindSocket();
 
+    // Connect the socket to remote_ip:remote_port, so the kernel resolves the route once
+    // instead of per send (for send-only sockets: only that peer's datagrams are received)
+    bool connectRemote();
+
     // Send a datagram to remote_ip:remote_port
     ssize_t send(const void *buffer, size_t length);
 
+    // Send one datagram made of iovcnt segments (e.g. header + payload) without copying
+    // them together. Returns bytes sent, or -1 on error (errno set)
+    virtual ssize_t sendv(const iovec *iov, size_t iovcnt);
+
+    // Send count datagrams (described by msgs[i].msg_hdr iovecs) to remote_ip:remote_port
+    // with a single sendmmsg() call. msg_name is filled in by this method.
+    // Returns number of datagrams sent (may be less than count), or -1 on error (errno set)
+    virtual int sendBatch(mmsghdr *msgs, unsigned int count);
+
+    // Maximum datagrams per sendSegmented() call (kernel UDP_MAX_SEGMENTS)
+    static constexpr size_t GSO_MAX_SEGMENTS = 64;
+
+    // True if the kernel supports UDP generic segmentation offload (UDP_SEGMENT, Linux 4.18+)
+    virtual bool gsoSupported() const;
+
+    // Send the bytes of iovcnt segments as consecutive datagrams of segment_size bytes
+    // (the last one may be shorter) with one sendmsg() and a UDP_SEGMENT cmsg.
+    // At most GSO_MAX_SEGMENTS datagrams, 65507 bytes in total.
+    // Returns bytes sent, or -1 on error (errno set, not logged: the caller may fall back)
+    virtual ssize_t sendSegmented(const iovec *iov, size_t iovcnt, uint16_t segment_size);
+
+    // Let the kernel coalesce trains of equally sized datagrams (UDP_GRO, Linux 5.0+).
+    // Receive with a MsgBatch that has enableSegmentInfo() and split by segmentSize()
+    // Returns false if the kernel does not support it
+    bool enableGro();
+
+    // Have the kernel timestamp every received datagram (SO_TIMESTAMPNS); receive with a
+    // MsgBatch that has enableTimestamps() and read MsgBatch::receiveTimeNs()
+    // Returns false if the kernel refuses
+    bool enableTimestamps();
+
     // Receive a datagram from the socket
     ssize_t receive(void *buffer, size_t length, sockaddr_in *sender_addr = nullptr);
 
+    // Receive up to batch.capacity() datagrams with a single recvmmsg() call
+    // Per-datagram length and sender address are available from the batch
+    // Returns number of datagrams received (0 if none pending), or -1 on error
+    int receiveBatch(MsgBatch &batch);
+
     // Get the socket file descriptor
     int getFd() const;
 
+    // Get the resolved remote address (for callers that build their own msghdr)
+    const sockaddr_in &getRemoteAddr() const;
+
 private:
     int fd_;
     int local_port_;
@@ -45,4 +101,11 @@ private:
     int remote_port_;
     sockaddr_in local_addr_;
     sockaddr_in remote_addr_;
+    // Rate-limited failure reports (EAGAIN = send buffer full, kept apart from other errors)
+    ErrorThrottle send_full_errors_;
+    ErrorThrottle send_errors_;
+    ErrorThrottle receive_errors_;
+    // Count and (rate-limited) log the failure in errno; errno is preserved
+    void reportSendError();
+    void reportReceiveError();
 };
@@ -0,0 +1,595 @@
+// udp_egress.cpp - Implementation of UdpEgress
+//
+// Datagrams are stored back to back in storage_ as [EntryHeader][payload][pad to 16].
+// When an entry does not fit between tail_ and the end of the ring, a WRAP_MARKER
+// header is written (if there is room for one) and the entry starts at offset 0.
+// count_ distinguishes a full ring (head_ == tail_, count_ > 0) from an empty one.
+//
+// flush() walks up to max_batch entries from head_ into the sendmmsg() window and
+// pops the ones the kernel accepted. send() hands datagrams in caller memory (any
+// number of segments each) to the kernel directly while the ring is empty. EAGAIN parks the rest and sets blocked_ until
+// the owner reports POLLOUT via onWritable(). Both paths go through transmit(), which
+// picks GSO for runs of equally sized datagrams when enabled.
+//
+// With a shaper, both paths first ask admit() how many leading datagrams conform and
+// transmit only those; transmit() charges the bucket for what the kernel accepted. A
+// datagram that does not conform ends the pass with throttled_ set; timeoutMs() wakes the
+// owner when tokens are due, and every flushIfDue() asks the shaper again (so a rate
+// changed at runtime takes effect at the next loop iteration).
+//
+// A tagged datagram keeps its DatagramTag in its entry header when it is gathered into the
+// ring, so the sent hook sees it whichever path finally sends it.
+
+#include "udp_egress.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+#include "logger.h"
+
+namespace
+{
+int64_t realtimeNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+} // namespace
+
+UdpEgress::UdpEgress(UdpServerSocket &udp, size_t max_batch, size_t queue_bytes, int max_delay_us,
+                     EgressDropPolicy drop_policy)
+    : udp_(udp), drop_policy_(drop_policy), max_delay_(max_delay_us),
+      head_(0), tail_(0), used_(0), count_(0),
+      reserved_offset_(0), reserved_length_(0), reserved_wrap_(false), reserved_tag_{NO_TAG, 0},
+      blocked_(false), dropped_(0), send_drops_("UDP send failed, datagram dropped"), max_batch_(max_batch),
+      gso_max_segments_(0), gso_segment_limit_(UINT16_MAX),
+      shaper_(nullptr), throttled_(false), throttled_until_ns_(0)
+{
+    if (max_batch == 0 || max_batch > MAX_BATCH)
+        throw std::runtime_error("UdpEgress: invalid batch size " + std::to_string(max_batch));
+    if (max_delay_us < 0)
+        throw std::runtime_error("UdpEgress: invalid max delay " + std::to_string(max_delay_us));
+    if (queue_bytes < minQueueBytes())
+        throw std::runtime_error("UdpEgress: queue size " + std::to_string(queue_bytes) + " is smaller than one max size datagram");
+
+    storage_.resize(queue_bytes & ~(sizeof(EntryHeader) - 1));
+    iovecs_.resize(max_batch);
+    msgs_.resize(max_batch);
+    memset(msgs_.data(), 0, msgs_.size() * sizeof(mmsghdr));
+
+    for (size_t i = 0; i < max_batch; ++i)
+    {
+        msgs_[i].msg_hdr.msg_iov = &iovecs_[i];
+        msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+size_t UdpEgress::minQueueBytes()
+{
+    return entrySize(UINT16_MAX);
+}
+
+size_t UdpEgress::entrySize(size_t length)
+{
+    // Entries stay aligned to the header size, so the space skipped at the end of the ring
+    // always has room for a WRAP_MARKER header
+    return sizeof(EntryHeader) + ((length + sizeof(EntryHeader) - 1) & ~(sizeof(EntryHeader) - 1));
+}
+
+// Find room for an entry of needed bytes; on success sets reserved_offset_/reserved_wrap_
+bool UdpEgress::reserve(size_t needed)
+{
+    const size_t capacity = storage_.size();
+    if (count_ == 0)
+    {
+        head_ = tail_ = used_ = 0;
+    }
+
+    if (tail_ > head_ || (tail_ == head_ && count_ == 0))
+    {
+        // Free space is [tail_, capacity) followed by [0, head_)
+        if (capacity - tail_ >= needed)
+        {
+            reserved_offset_ = tail_;
+            reserved_wrap_ = false;
+            return true;
+        }
+        if (head_ >= needed)
+        {
+            reserved_offset_ = 0;
+            reserved_wrap_ = true;
+            return true;
+        }
+        return false;
+    }
+
+    // Free space is [tail_, head_) (empty when the ring is full)
+    if (head_ - tail_ >= needed)
+    {
+        reserved_offset_ = tail_;
+        reserved_wrap_ = false;
+        return true;
+    }
+    return false;
+}
+
+UdpEgress::EntryHeader UdpEgress::popHead()
+{
+    const size_t capacity = storage_.size();
+    if (head_ == capacity || reinterpret_cast<EntryHeader *>(&storage_[head_])->length == WRAP_MARKER)
+    {
+        used_ -= capacity - head_;
+        head_ = 0;
+    }
+
+    EntryHeader entry = *reinterpret_cast<EntryHeader *>(&storage_[head_]);
+    size_t size = entrySize(entry.length);
+    head_ += size;
+    used_ -= size;
+    --count_;
+
+    if (count_ == 0)
+    {
+        head_ = tail_ = used_ = 0;
+    }
+    return entry;
+}
+
+void UdpEgress::reportSent(const DatagramTag *tags, size_t n)
+{
+    if (!sent_hook_ || !tags)
+        return;
+    int64_t sent_ns = realtimeNs();
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (tags[i].id != NO_TAG)
+            sent_hook_(tags[i], sent_ns);
+    }
+}
+
+void UdpEgress::setSentHook(SentHook hook)
+{
+    sent_hook_ = std::move(hook);
+}
+
+void UdpEgress::dropHead()
+{
+    EntryHeader entry = popHead();
+    if (dropped_hook_ && entry.tag_id != NO_TAG)
+        dropped_hook_(DatagramTag{entry.tag_id, entry.tag_time_ns});
+}
+
+void UdpEgress::setDroppedHook(DroppedHook hook)
+{
+    dropped_hook_ = std::move(hook);
+}
+
+uint8_t *UdpEgress::acquire(size_t length)
+{
+    size_t needed = entrySize(length);
+    if (needed > storage_.size())
+    {
+        ++dropped_;
+        return nullptr;
+    }
+
+    while (!reserve(needed))
+    {
+        // Try to make room by sending before dropping anything (the shaper may refuse)
+        if (!blocked_ && count_ > 0)
+        {
+            size_t before = count_;
+            flush();
+            if (count_ < before)
+                continue;
+        }
+        if (drop_policy_ == EgressDropPolicy::DROP_OLDEST && count_ > 0)
+        {
+            dropHead();
+            ++dropped_;
+            continue;
+        }
+        ++dropped_;
+        return nullptr;
+    }
+
+    reserved_length_ = length;
+    return storage_.data() + reserved_offset_ + sizeof(EntryHeader);
+}
+
+void UdpEgress::commit()
+{
+    const size_t capacity = storage_.size();
+    if (reserved_wrap_)
+    {
+        // Mark the skipped space at the end of the ring so the reader wraps
+        if (capacity - tail_ >= sizeof(EntryHeader))
+            reinterpret_cast<EntryHeader *>(&storage_[tail_])->length = WRAP_MARKER;
+        used_ += capacity - tail_;
+        tail_ = 0;
+    }
+
+    EntryHeader *hdr = reinterpret_cast<EntryHeader *>(&storage_[tail_]);
+    hdr->length = static_cast<uint32_t>(reserved_length_);
+    hdr->tag_id = reserved_tag_.id;
+    hdr->tag_time_ns = reserved_tag_.time_ns;
+    reserved_tag_ = {NO_TAG, 0};
+    size_t size = entrySize(reserved_length_);
+    tail_ += size;
+    used_ += size;
+
+    if (count_++ == 0)
+        first_pending_ = std::chrono::steady_clock::now();
+
+    if (!blocked_ && count_ >= max_batch_)
+        flush();
+}
+
+size_t UdpEgress::send(mmsghdr *datagrams, size_t count, const DatagramTag *tags)
+{
+    size_t done = 0;
+    size_t accepted = 0;
+
+    // Direct path: nothing may overtake queued datagrams, and a delayed batch collects in the ring
+    if (count_ == 0 && !blocked_ && max_delay_.count() == 0)
+    {
+        while (done < count)
+        {
+            // Segments go to the kernel as they are, as far as the shaper allows
+            size_t allowed = admit(datagrams + done, count - done);
+            if (allowed == 0)
+                break;
+            int ret = transmit(datagrams + done, allowed);
+            if (ret > 0)
+            {
+                reportSent(tags ? tags + done : nullptr, ret);
+                done += ret;
+                accepted += ret;
+                continue;
+            }
+
+            if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS))
+            {
+                // Socket buffer full: the rest is parked below until POLLOUT
+                blocked_ = true;
+                break;
+            }
+
+            send_drops_.report(errno);
+            ++done;
+        }
+    }
+
+    // Gather whatever was not sent into the ring
+    for (; done < count; ++done)
+    {
+        const msghdr &hdr = datagrams[done].msg_hdr;
+        uint8_t *buffer = acquire(datagramLength(hdr));
+        if (!buffer)
+            continue;
+        for (size_t k = 0; k < hdr.msg_iovlen; ++k)
+        {
+            memcpy(buffer, hdr.msg_iov[k].iov_base, hdr.msg_iov[k].iov_len);
+            buffer += hdr.msg_iov[k].iov_len;
+        }
+        if (tags)
+            reserved_tag_ = tags[done];
+        commit();
+        ++accepted;
+    }
+    return accepted;
+}
+
+size_t UdpEgress::datagramLength(const msghdr &hdr)
+{
+    size_t length = 0;
+    for (size_t k = 0; k < hdr.msg_iovlen; ++k)
+        length += hdr.msg_iov[k].iov_len;
+    return length;
+}
+
+int UdpEgress::flush()
+{
+    const size_t capacity = storage_.size();
+    int sent = 0;
+    while (count_ > 0 && !blocked_)
+    {
+        // Fill the sendmmsg() window from the oldest entries
+        size_t n = 0;
+        size_t offset = head_;
+        for (; n < count_ && n < msgs_.size(); ++n)
+        {
+            if (offset == capacity || reinterpret_cast<EntryHeader *>(&storage_[offset])->length == WRAP_MARKER)
+                offset = 0;
+            const EntryHeader *hdr = reinterpret_cast<const EntryHeader *>(&storage_[offset]);
+            iovecs_[n].iov_base = &storage_[offset + sizeof(EntryHeader)];
+            iovecs_[n].iov_len = hdr->length;
+            offset += entrySize(hdr->length);
+        }
+
+        n = admit(msgs_.data(), n);
+        if (n == 0)
+            break;
+        int ret = transmit(msgs_.data(), n);
+        if (ret > 0)
+        {
+            int64_t sent_ns = sent_hook_ ? realtimeNs() : 0;
+            for (int i = 0; i < ret; ++i)
+            {
+                EntryHeader entry = popHead();
+                if (sent_hook_ && entry.tag_id != NO_TAG)
+                    sent_hook_(DatagramTag{entry.tag_id, entry.tag_time_ns}, sent_ns);
+            }
+            sent += ret;
+            continue;
+        }
+
+        if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS))
+        {
+            // Socket buffer full: park the rest until POLLOUT
+            blocked_ = true;
+            break;
+        }
+
+        // Hard error on the oldest datagram: drop it so it cannot stall the queue
+        send_drops_.report(errno);
+        dropHead();
+    }
+
+    if (count_ > 0 && !blocked_ && !throttled_)
+        first_pending_ = std::chrono::steady_clock::now();
+    return sent;
+}
+
+int UdpEgress::transmit(mmsghdr *msgs, size_t n)
+{
+    size_t plain = n;
+    if (gso_max_segments_ > 1)
+    {
+        size_t run = gsoRun(msgs, n);
+        if (run > 1)
+        {
+            int ret = sendGso(msgs, run);
+            if (ret > 0)
+                charge(msgs, ret);
+            if (ret != 0)
+                return ret;
+            // Rejected: this run goes out as plain datagrams
+        }
+        else
+        {
+            // Plain datagrams up to where the next GSO run starts
+            for (plain = 1; plain < n && gsoRun(msgs + plain, n - plain) < 2; ++plain)
+            {
+            }
+        }
+    }
+    if (plain > max_batch_)
+        plain = max_batch_;
+
+    int ret;
+    if (plain == 1)
+    {
+        const msghdr &hdr = msgs[0].msg_hdr;
+        ret = udp_.sendv(hdr.msg_iov, hdr.msg_iovlen) < 0 ? -1 : 1;
+    }
+    else
+    {
+        ret = udp_.sendBatch(msgs, plain);
+    }
+    ++stats_.send_calls;
+    if (ret > 0)
+    {
+        stats_.datagrams += ret;
+        charge(msgs, ret);
+    }
+    return ret;
+}
+
+size_t UdpEgress::admit(const mmsghdr *msgs, size_t n)
+{
+    throttled_ = false;
+    if (!shaper_ || !shaper_->enabled())
+        return n;
+
+    const int64_t now = TokenBucket::nowNs();
+    const uint64_t burst = shaper_->burstBytes();
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        bytes += datagramLength(msgs[i].msg_hdr);
+        // One pass sends at most a burst (a single larger datagram goes out on a full bucket)
+        if (i > 0 && bytes > burst)
+            return i;
+        int64_t delay = shaper_->delayNs(bytes, now);
+        if (delay > 0)
+        {
+            if (i == 0)
+            {
+                throttled_ = true;
+                throttled_until_ns_ = now + delay;
+                ++stats_.shaper_waits;
+            }
+            return i;
+        }
+    }
+    return n;
+}
+
+void UdpEgress::charge(const mmsghdr *msgs, size_t sent)
+{
+    if (!shaper_)
+        return;
+    size_t bytes = 0;
+    for (size_t i = 0; i < sent; ++i)
+        bytes += datagramLength(msgs[i].msg_hdr);
+    shaper_->consume(bytes, TokenBucket::nowNs());
+}
+
+size_t UdpEgress::gsoRun(const mmsghdr *msgs, size_t n) const
+{
+    size_t segment_size = datagramLength(msgs[0].msg_hdr);
+    if (segment_size == 0 || segment_size > gso_segment_limit_)
+        return 1;
+
+    size_t total = segment_size;
+    size_t iovcnt = msgs[0].msg_hdr.msg_iovlen;
+    size_t run = 1;
+    while (run < n && run < gso_max_segments_)
+    {
+        const msghdr &hdr = msgs[run].msg_hdr;
+        size_t length = datagramLength(hdr);
+        if (length == 0 || length > segment_size || total + length > GSO_MAX_BYTES ||
+            iovcnt + hdr.msg_iovlen > gso_iovecs_.size())
+            break;
+        total += length;
+        iovcnt += hdr.msg_iovlen;
+        ++run;
+        // Only the last segment may be shorter
+        if (length < segment_size)
+            break;
+    }
+    return run;
+}
+
+int UdpEgress::sendGso(const mmsghdr *msgs, size_t run)
+{
+    size_t iovcnt = 0;
+    for (size_t i = 0; i < run; ++i)
+    {
+        const msghdr &hdr = msgs[i].msg_hdr;
+        for (size_t k = 0; k < hdr.msg_iovlen; ++k)
+            gso_iovecs_[iovcnt++] = hdr.msg_iov[k];
+    }
+
+    size_t segment_size = datagramLength(msgs[0].msg_hdr);
+    ssize_t ret = udp_.sendSegmented(gso_iovecs_.data(), iovcnt, static_cast<uint16_t>(segment_size));
+    ++stats_.send_calls;
+    if (ret >= 0)
+    {
+        ++stats_.gso_sends;
+        stats_.gso_datagrams += run;
+        stats_.datagrams += run;
+        return static_cast<int>(run);
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+        return -1;
+
+    if (errno == EINVAL)
+    {
+        // Typically a segment larger than the path MTU: keep GSO for smaller segments
+        Logger::error("UDP GSO rejected " + std::to_string(segment_size) + "-byte segments (" + strerror(errno) + "), sending them without GSO");
+        gso_segment_limit_ = segment_size - 1;
+    }
+    else
+    {
+        Logger::error(std::string("UDP GSO send failed (") + strerror(errno) + "), GSO disabled");
+        gso_max_segments_ = 0;
+    }
+    return 0;
+}
+
+bool UdpEgress::enableGso(size_t max_segments)
+{
+    if (max_segments > UdpServerSocket::GSO_MAX_SEGMENTS)
+        max_segments = UdpServerSocket::GSO_MAX_SEGMENTS;
+    if (max_segments < 2 || !udp_.gsoSupported())
+        return false;
+
+    gso_max_segments_ = max_segments;
+    gso_segment_limit_ = UINT16_MAX;
+    gso_iovecs_.resize(2 * max_segments);
+
+    // Let the ring window hold a full GSO run
+    if (msgs_.size() < max_segments)
+    {
+        iovecs_.resize(max_segments);
+        msgs_.resize(max_segments);
+        memset(msgs_.data(), 0, msgs_.size() * sizeof(mmsghdr));
+        for (size_t i = 0; i < msgs_.size(); ++i)
+        {
+            msgs_[i].msg_hdr.msg_iov = &iovecs_[i];
+            msgs_[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+    return true;
+}
+
+bool UdpEgress::gsoEnabled() const
+{
+    return gso_max_segments_ > 1;
+}
+
+const UdpEgress::Stats &UdpEgress::stats() const
+{
+    return stats_;
+}
+
+void UdpEgress::flushIfDue()
+{
+    if (count_ == 0 || blocked_)
+        return;
+    if (std::chrono::steady_clock::now() - first_pending_ >= max_delay_)
+        flush();
+}
+
+bool UdpEgress::wantsWritable() const
+{
+    return blocked_;
+}
+
+void UdpEgress::onWritable()
+{
+    blocked_ = false;
+    flush();
+}
+
+size_t UdpEgress::pending() const
+{
+    return count_;
+}
+
+size_t UdpEgress::queuedBytes() const
+{
+    return used_;
+}
+
+uint64_t UdpEgress::dropped() const
+{
+    return dropped_;
+}
+
+int UdpEgress::timeoutMs() const
+{
+    if (count_ == 0 || blocked_)
+        return -1;
+    // Round up so the batch is due (and the tokens are there) when poll() returns
+    int timeout = 0;
+    auto elapsed = std::chrono::steady_clock::now() - first_pending_;
+    if (elapsed < max_delay_)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(max_delay_ - elapsed);
+        timeout = static_cast<int>((remaining.count() + 999) / 1000);
+    }
+    if (throttled_)
+    {
+        int64_t wait_ns = throttled_until_ns_ - TokenBucket::nowNs();
+        if (wait_ns > 0)
+            timeout = std::max(timeout, static_cast<int>((wait_ns + 999999) / 1000000));
+    }
+    return timeout;
+}
+
+void UdpEgress::setShaper(TokenBucket *shaper)
+{
+    shaper_ = shaper;
+    throttled_ = false;
+}
+
+bool UdpEgress::throttled() const
+{
+    return throttled_ && count_ > 0;
+}
@@ -0,0 +1,248 @@
+// udp_egress.h - Bounded, non-blocking UDP egress queue
+//
+// UdpEgress queues outgoing datagrams in a preallocated byte ring and hands them to
+// the kernel in batches with sendmmsg() (UdpServerSocket::sendBatch). It never
+// sleeps: when the socket send buffer is full (EAGAIN) the remaining datagrams stay
+// parked in the ring and the owner is asked to wait for POLLOUT (wantsWritable()),
+// after which onWritable() resumes transmission.
+//
+// Batches are sent when:
+//   - max_batch datagrams are pending
+//   - the oldest pending datagram is older than max_delay_us (see flushIfDue())
+//   - the owner calls flush() explicitly (e.g. at shutdown)
+//
+// With max_delay_us == 0, flushIfDue() flushes whatever is pending, so calling it at
+// the end of every event-loop iteration sends everything produced in that iteration
+// with one syscall.
+//
+// The ring holds at most queue_bytes of datagrams (plus small per-datagram framing).
+// When it is full the drop policy decides which datagram is lost:
+//   - DROP_NEWEST: the datagram being queued is rejected (acquire() returns nullptr)
+//   - DROP_OLDEST: the oldest parked datagrams are discarded to make room
+//
+// Zero-copy path: send() takes datagrams that live in caller memory as scatter-gather
+// segments (e.g. a GSL-FSL header plus the payload still in its receive buffer). When
+// nothing is queued ahead of them and batching is immediate (max_delay_us == 0), the
+// segments go to sendmsg()/sendmmsg() as they are; only what the kernel does not accept
+// is gathered (copied) into the ring.
+//
+// GSO (opt-in, enableGso()): a run of consecutive datagrams of equal size (the last
+// may be shorter) is handed to the kernel as one sendmsg() with a UDP_SEGMENT cmsg,
+// up to 64 datagrams per call. If the kernel rejects a segment size (EINVAL, e.g. larger
+// than the path MTU) that size and larger ones are sent without GSO; any other GSO
+// failure turns GSO off. stats() reports datagrams per send syscall either way.
+//
+// Shaping (opt-in, setShaper()): every datagram must conform to a TokenBucket before it
+// is handed to the kernel. Datagrams that arrive faster than the rate wait in the ring
+// (subject to the drop policy like any backlog) and throttled() is true until tokens
+// are available; timeoutMs() then reports when, so the owner's poll() wakes up in time
+// to send them. The egress never sleeps waiting for tokens.
+//
+// Send tracking (opt-in, setSentHook()): datagrams passed to send() with a DatagramTag are
+// reported to the hook when the kernel takes them, whether sent directly or later from the
+// ring, so the owner can measure the time from its receive to the actual send. Tagged
+// datagrams that leave the ring unsent (evicted by DROP_OLDEST, or a hard send error) go to
+// the dropped hook (setDroppedHook()), so the owner can count the loss on their source.
+//
+// Usage:
+//   - egress.send(msgs, count) for datagrams in caller memory (valid during the call), or
+//   - uint8_t *buf = egress.acquire(length); ...write datagram...; egress.commit();
+//   - poll() with POLLOUT when egress.wantsWritable(), call egress.onWritable() on POLLOUT
+//   - egress.flushIfDue() at the end of each event-loop iteration
+//   - poll(..., egress.timeoutMs()) so a delayed batch is not held forever
+
+#pragma once
+#include <chrono>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "error_throttle.h"
+#include "token_bucket.h"
+#include "udp.h"
+
+// Which datagram to drop when the egress queue is full
+enum class EgressDropPolicy
+{
+    DROP_NEWEST,
+    DROP_OLDEST
+};
+
+// UdpEgress: sendmmsg-based, POLLOUT-driven egress queue in front of a UdpServerSocket
+class UdpEgress
+{
+public:
+    // Constructor: queue of queue_bytes, sent in batches of up to max_batch datagrams
+    UdpEgress(UdpServerSocket &udp, size_t max_batch, size_t queue_bytes, int max_delay_us,
+              EgressDropPolicy drop_policy = EgressDropPolicy::DROP_NEWEST);
+
+    // Largest max_batch (one sendmmsg())
+    static constexpr size_t MAX_BATCH = 1024;
+    // Smallest queue_bytes: room for one maximum size UDP datagram
+    static size_t minQueueBytes();
+
+    // Reserve room for a datagram of length bytes
+    // Returns the buffer to write it into, or nullptr if it was dropped (queue full)
+    uint8_t *acquire(size_t length);
+
+    // Queue the datagram written into the buffer returned by the last acquire()
+    void commit();
+
+    // Caller's tag for a datagram passed to send(), handed back to the sent hook
+    struct DatagramTag
+    {
+        uint32_t id;     // e.g. source channel
+        int64_t time_ns; // e.g. receive time
+    };
+    // DatagramTag::id of a datagram not reported to the hook
+    static constexpr uint32_t NO_TAG = 0xFFFFFFFFu;
+    // Called for every tagged datagram the kernel accepted; sent_ns is CLOCK_REALTIME
+    using SentHook = std::function<void(const DatagramTag &tag, int64_t sent_ns)>;
+    // Called for every tagged datagram removed from the ring without being sent (datagrams
+    // send() could not queue are not reported: its return value counts them)
+    using DroppedHook = std::function<void(const DatagramTag &tag)>;
+
+    // Send count datagrams, each described by the iovecs of datagrams[i].msg_hdr
+    // (msg_name is filled in). The memory only has to stay valid during the call:
+    // datagrams that cannot be sent directly (queue not empty, delayed batching, socket
+    // buffer full) are gathered into the ring. tags (optional) holds one tag per datagram.
+    // Returns number of datagrams sent or queued (the rest were dropped)
+    size_t send(mmsghdr *datagrams, size_t count, const DatagramTag *tags = nullptr);
+
+    // Report tagged datagrams to hook once sent (empty hook = off)
+    void setSentHook(SentHook hook);
+
+    // Report tagged datagrams dropped from the ring to hook (empty hook = off)
+    void setDroppedHook(DroppedHook hook);
+
+    // Send pending datagrams until the queue is empty or the socket would block
+    // Returns number of datagrams sent
+    int flush();
+
+    // Flush if the oldest pending datagram has waited max_delay_us or longer
+    void flushIfDue();
+
+    // True if transmission is stalled on a full socket buffer (wait for POLLOUT)
+    bool wantsWritable() const;
+
+    // Socket became writable: resume transmission
+    void onWritable();
+
+    // Number of datagrams waiting to be sent
+    size_t pending() const;
+
+    // Bytes of ring space currently in use
+    size_t queuedBytes() const;
+
+    // Number of datagrams dropped because the queue was full
+    uint64_t dropped() const;
+
+    // Poll timeout (ms) until the pending batch is due (and, when throttled, the shaper has
+    // tokens for it), or -1 if there is nothing to time
+    int timeoutMs() const;
+
+    // Pace transmission with shaper (may be shared with other egress queues; nullptr = off)
+    void setShaper(TokenBucket *shaper);
+
+    // True while pending datagrams wait for shaper tokens
+    bool throttled() const;
+
+    // Send runs of equally sized datagrams with UDP GSO, up to max_segments per call
+    // Returns false (GSO stays off) if the kernel does not support it
+    bool enableGso(size_t max_segments);
+
+    // True while GSO is in use (it turns itself off if the kernel rejects it)
+    bool gsoEnabled() const;
+
+    // Send counters (datagrams / send_calls = datagrams per syscall)
+    struct Stats
+    {
+        uint64_t send_calls = 0;     // sendmsg()/sendmmsg() calls, including GSO sends
+        uint64_t datagrams = 0;      // datagrams accepted by the kernel
+        uint64_t gso_sends = 0;      // GSO sendmsg() calls
+        uint64_t gso_datagrams = 0;  // datagrams sent as GSO segments
+        uint64_t shaper_waits = 0;   // times transmission stopped to wait for shaper tokens
+    };
+    const Stats &stats() const;
+
+private:
+    // Ring entry framing: every datagram is preceded by a 16-byte header
+    struct EntryHeader
+    {
+        uint32_t length;
+        uint32_t tag_id; // DatagramTag of send() (NO_TAG: untagged)
+        int64_t tag_time_ns;
+    };
+    static constexpr uint32_t WRAP_MARKER = 0xFFFFFFFFu;
+
+    // Largest UDP payload GSO can carry in one call (IPv4)
+    static constexpr size_t GSO_MAX_BYTES = 65507;
+
+    static size_t entrySize(size_t length);
+    static size_t datagramLength(const msghdr &hdr);
+    bool reserve(size_t needed);
+    // Remove the oldest entry; returns its header
+    EntryHeader popHead();
+    // Hand sent tagged datagrams to the sent hook
+    void reportSent(const DatagramTag *tags, size_t n);
+    // Remove the oldest entry without sending it and hand its tag to the dropped hook
+    void dropHead();
+
+    // Number of leading datagrams of msgs the shaper lets through now (sets throttled_ if
+    // the first one has to wait)
+    size_t admit(const mmsghdr *msgs, size_t n);
+    // Take tokens for the sent leading datagrams of msgs
+    void charge(const mmsghdr *msgs, size_t sent);
+
+    // Send leading datagrams of msgs with one syscall (GSO run, sendmsg() or sendmmsg())
+    // Returns number of datagrams sent, or -1 (errno set)
+    int transmit(mmsghdr *msgs, size_t n);
+    // Number of leading datagrams that can go out as one GSO send (1 = none)
+    size_t gsoRun(const mmsghdr *msgs, size_t n) const;
+    // Returns run if sent, -1 on error (errno set), 0 if GSO was rejected (send plain)
+    int sendGso(const mmsghdr *msgs, size_t run);
+
+    UdpServerSocket &udp_;
+    EgressDropPolicy drop_policy_;
+    std::chrono::microseconds max_delay_;
+    std::chrono::steady_clock::time_point first_pending_;
+
+    // Byte ring
+    std::vector<uint8_t> storage_;
+    size_t head_;  // offset of oldest entry
+    size_t tail_;  // offset where the next entry is written
+    size_t used_;  // bytes in use, including space skipped at the end on wrap
+    size_t count_; // datagrams queued
+
+    // Pending reservation (between acquire() and commit())
+    size_t reserved_offset_;
+    size_t reserved_length_;
+    bool reserved_wrap_;
+    DatagramTag reserved_tag_; // written into the entry by commit()
+    SentHook sent_hook_;
+    DroppedHook dropped_hook_;
+
+    bool blocked_;
+    uint64_t dropped_;
+    // Datagrams dropped on a hard send error (rate-limited report)
+    ErrorThrottle send_drops_;
+
+    // sendmmsg() window (max_batch_ datagrams, more if a GSO run may be longer)
+    size_t max_batch_;
+    std::vector<iovec> iovecs_;
+    std::vector<mmsghdr> msgs_;
+
+    // GSO: run length limit (0 = off), largest segment size the kernel accepted, gather list
+    size_t gso_max_segments_;
+    size_t gso_segment_limit_;
+    std::vector<iovec> gso_iovecs_;
+
+    // Shaper: not owned; throttled_ until throttled_until_ns_ (TokenBucket::nowNs() time)
+    TokenBucket *shaper_;
+    bool throttled_;
+    int64_t throttled_until_ns_;
+
+    Stats stats_;
+};
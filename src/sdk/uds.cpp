@@ -9,10 +9,14 @@
 // Key methods:
 //   - bindSocket(): Bind the socket to my_path_ (server)
 //   - send(): Send a datagram to target_path_ (client)
-//   - receive(): Receive a datagram from the socket
+//   - sendv(): Send a datagram gathered from several segments with sendmsg() (client)
+//   - sendBatch(): Send several datagrams to target_path_ with sendmmsg() (client)
+//   - receive(): Receive a datagram from the socket (recvmsg() when the receive time is wanted)
+//   - receiveBatch(): Drain up to N datagrams per call using recvmmsg()
+//   - enableTimestamps(): SO_TIMESTAMPNS
 //
 // Error handling: Throws std::runtime_error on socket creation/binding errors.
-// Logs send/receive errors using perror.
+// Send/receive errors are reported through ErrorThrottle (first failure, then a summary per second).
 
 #include "uds.h"
 #include <unistd.h>
@@ -23,9 +27,14 @@
 #include <sys/socket.h>
 #include <iostream>
 #include <fcntl.h>
+#include <cerrno>
+#include <ctime>
 
 UdsSocket::UdsSocket(const std::string &my_path, const std::string &target_path)
-    : fd_(-1), my_path_(my_path), target_path_(target_path)
+    : fd_(-1), my_path_(my_path), target_path_(target_path),
+      send_full_errors_("UDS send failed", my_path.empty() ? target_path : my_path),
+      send_errors_("UDS send failed", my_path.empty() ? target_path : my_path),
+      receive_errors_("UDS receive failed", my_path.empty() ? target_path : my_path)
 {
     memset(&server_addr_, 0, sizeof(server_addr_));
     server_addr_.sun_family = AF_UNIX;
@@ -94,19 +103,62 @@ bool UdsSocket::bindSocket()
     return true;
 }
 
+void UdsSocket::reportSendError()
+{
+    int saved_errno = errno;
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+        send_full_errors_.report(saved_errno);
+    else
+        send_errors_.report(saved_errno);
+    errno = saved_errno;
+}
+
+void UdsSocket::reportReceiveError()
+{
+    int saved_errno = errno;
+    receive_errors_.report(saved_errno);
+    errno = saved_errno;
+}
+
 ssize_t UdsSocket::send(const void *buffer, size_t length)
 {
     ssize_t sent = sendto(fd_, buffer, length, 0, (struct sockaddr *)&target_addr_, sizeof(target_addr_));
     if (sent < 0)
     {
-        if (errno == EAGAIN || errno == EWOULDBLOCK)
-        {
-            std::cerr << "[ERROR] UDS sendto failed: buffer full (EAGAIN/EWOULDBLOCK)\n";
-        }
-        else
-        {
-            perror("[ERROR] UDS sendto failed");
-        }
+        reportSendError();
+    }
+    return sent;
+}
+
+ssize_t UdsSocket::sendv(const iovec *iov, size_t iovcnt)
+{
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &target_addr_;
+    msg.msg_namelen = sizeof(target_addr_);
+    msg.msg_iov = const_cast<iovec *>(iov);
+    msg.msg_iovlen = iovcnt;
+
+    ssize_t sent = sendmsg(fd_, &msg, 0);
+    if (sent < 0)
+    {
+        reportSendError();
+    }
+    return sent;
+}
+
+int UdsSocket::sendBatch(mmsghdr *msgs, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        msgs[i].msg_hdr.msg_name = &target_addr_;
+        msgs[i].msg_hdr.msg_namelen = sizeof(target_addr_);
+    }
+
+    int sent = sendmmsg(fd_, msgs, count, 0);
+    if (sent < 0)
+    {
+        reportSendError();
     }
     return sent;
 }
@@ -116,8 +168,56 @@ ssize_t UdsSocket::receive(void *buffer, size_t length)
     ssize_t received = recvfrom(fd_, buffer, length, 0, NULL, NULL);
     if (received < 0)
     {
-        perror("[ERROR] UDS recvfrom failed");
+        reportReceiveError();
+    }
+    return received;
+}
+
+ssize_t UdsSocket::receive(void *buffer, size_t length, int64_t &receive_ns)
+{
+    iovec iov = {buffer, length};
+    alignas(cmsghdr) uint8_t control[CMSG_SPACE(sizeof(timespec))];
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t received = recvmsg(fd_, &msg, 0);
+    if (received < 0)
+    {
+        reportReceiveError();
+        receive_ns = 0;
+        return received;
+    }
+    receive_ns = MsgBatch::timestampNs(msg);
+    return received;
+}
+
+bool UdsSocket::enableTimestamps()
+{
+    int on = 1;
+    return setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0;
+}
+
+int UdsSocket::receiveBatch(MsgBatch &batch)
+{
+    return receiveBatch(batch, batch.capacity());
+}
+
+int UdsSocket::receiveBatch(MsgBatch &batch, size_t max_count)
+{
+    mmsghdr *msgs = batch.prepare();
+    unsigned int count = static_cast<unsigned int>(max_count < batch.capacity() ? max_count : batch.capacity());
+    int received = recvmmsg(fd_, msgs, count, MSG_DONTWAIT, NULL);
+    if (received < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+        reportReceiveError();
+        return -1;
     }
+    batch.setSize(received);
     return received;
 }
 
@@ -11,7 +11,11 @@
 // Methods:
 //   - bindSocket(): Bind the socket to my_path_ (for servers)
 //   - send(): Send a datagram to target_path_
-//   - receive(): Receive a datagram from the socket
+//   - sendv(): Send one datagram gathered from several buffers (sendmsg() iovecs)
+//   - sendBatch(): Send several datagrams to target_path_ with one sendmmsg() call
+//   - receive(): Receive a datagram from the socket (optionally with its receive time)
+//   - receiveBatch(): Receive up to N datagrams with a single recvmmsg() call
+//   - enableTimestamps(): Kernel receive timestamps (SO_TIMESTAMPNS)
 //   - getFd(): Get the socket file descriptor
 //   - getMyPath(): Get the bound path (server)
 
@@ -19,6 +23,9 @@
 #include <string>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/uio.h>
+#include "error_throttle.h"
+#include "msg_batch.h"
 
 // UdsSocket: Unix Domain Socket wrapper for FSL
 class UdsSocket
@@ -39,9 +46,33 @@ public:
     // Send a datagram to target_path (client)
     virtual ssize_t send(const void *buffer, size_t length);
 
+    // Send one datagram made of iovcnt segments to target_path without copying them together
+    // Returns bytes sent, or -1 on error (errno set)
+    ssize_t sendv(const iovec *iov, size_t iovcnt);
+
+    // Send count datagrams (described by msgs[i].msg_hdr iovecs) to target_path
+    // with a single sendmmsg() call. msg_name is filled in by this method.
+    // Returns number of datagrams sent (may be less than count), or -1 on error (errno set)
+    int sendBatch(mmsghdr *msgs, unsigned int count);
+
     // Receive a datagram from the socket
     ssize_t receive(void *buffer, size_t length);
 
+    // Receive a datagram and its kernel receive time (CLOCK_REALTIME ns, 0 if not reported)
+    ssize_t receive(void *buffer, size_t length, int64_t &receive_ns);
+
+    // Have the kernel timestamp every received datagram (SO_TIMESTAMPNS); read the time
+    // with receive(buffer, length, receive_ns) or MsgBatch::enableTimestamps()
+    // Returns false if the kernel refuses
+    bool enableTimestamps();
+
+    // Receive up to batch.capacity() datagrams with a single recvmmsg() call
+    // Returns number of datagrams received (0 if none pending), or -1 on error
+    int receiveBatch(MsgBatch &batch);
+
+    // As receiveBatch(batch), but at most max_count datagrams (a scheduler's share)
+    int receiveBatch(MsgBatch &batch, size_t max_count);
+
     // Get the socket file descriptor
     int getFd() const;
 
@@ -54,4 +85,11 @@ private:
     std::string target_path_;
     sockaddr_un server_addr_;
     sockaddr_un target_addr_;
+    // Rate-limited failure reports (EAGAIN = peer not draining, kept apart from other errors)
+    ErrorThrottle send_full_errors_;
+    ErrorThrottle send_errors_;
+    ErrorThrottle receive_errors_;
+    // Count and (rate-limited) log the failure in errno; errno is preserved
+    void reportSendError();
+    void reportReceiveError();
 };
@@ -0,0 +1,381 @@
+// uring.cpp - Implementation of IoUring and IoUringBufferRing
+//
+// The rings are mapped with the classic io_uring_setup() layout. The kernel is the
+// only writer of sq_head/cq_tail and we are the only writer of sq_tail/cq_head, so
+// acquire/release atomics on those indices are the only synchronisation needed.
+//
+// Support is probed at construction: the kernel must report IORING_FEAT_SINGLE_MMAP
+// and IORING_FEAT_EXT_ARG, and IORING_OP_SEND_ZC is used as a marker for a 6.0+
+// kernel (the release that added multishot recv).
+
+#include "uring.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef FSL_HAVE_IO_URING
+
+namespace
+{
+int sysSetup(unsigned entries, io_uring_params *params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sysEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, const void *arg, size_t arg_size)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+int sysRegister(int fd, unsigned opcode, const void *arg, unsigned nr_args)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+template <typename T>
+T *offsetPtr(void *base, unsigned offset)
+{
+    return reinterpret_cast<T *>(static_cast<uint8_t *>(base) + offset);
+}
+
+bool opSupported(int fd, unsigned opcode)
+{
+    std::vector<uint8_t> storage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(storage.data());
+    if (sysRegister(fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+        return false;
+    return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+}
+} // namespace
+
+IoUring::IoUring(unsigned entries)
+    : fd_(-1), sq_ring_(MAP_FAILED), cq_ring_(MAP_FAILED), sq_ring_size_(0), cq_ring_size_(0),
+      sqes_(nullptr), sqes_size_(0), sqe_tail_(0), enter_calls_(0)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER;
+    fd_ = sysSetup(entries, &params);
+    if (fd_ < 0 && errno == EINVAL)
+    {
+        // Older kernel without the task-run hints: plain ring
+        memset(&params, 0, sizeof(params));
+        fd_ = sysSetup(entries, &params);
+    }
+    if (fd_ < 0)
+        throw std::runtime_error(std::string("io_uring_setup failed: ") + strerror(errno));
+
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG) ||
+        !opSupported(fd_, IORING_OP_SEND_ZC))
+    {
+        close(fd_);
+        throw std::runtime_error("io_uring: kernel too old (need Linux 6.0+)");
+    }
+
+    // SQ and CQ rings share one mapping (IORING_FEAT_SINGLE_MMAP)
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (cq_ring_size_ > sq_ring_size_)
+        sq_ring_size_ = cq_ring_size_;
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED)
+    {
+        close(fd_);
+        throw std::runtime_error("io_uring: failed to map rings");
+    }
+    cq_ring_ = sq_ring_;
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        munmap(sq_ring_, sq_ring_size_);
+        close(fd_);
+        throw std::runtime_error("io_uring: failed to map SQEs");
+    }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    sq_head_ = offsetPtr<unsigned>(sq_ring_, params.sq_off.head);
+    sq_tail_ = offsetPtr<unsigned>(sq_ring_, params.sq_off.tail);
+    sq_mask_ = *offsetPtr<unsigned>(sq_ring_, params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sqe_tail_ = *sq_tail_;
+
+    // Identity mapping: SQ array slot i always refers to SQE i
+    unsigned *sq_array = offsetPtr<unsigned>(sq_ring_, params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries_; ++i)
+        sq_array[i] = i;
+
+    cq_head_ = offsetPtr<unsigned>(cq_ring_, params.cq_off.head);
+    cq_tail_ = offsetPtr<unsigned>(cq_ring_, params.cq_off.tail);
+    cq_mask_ = *offsetPtr<unsigned>(cq_ring_, params.cq_off.ring_mask);
+    cqes_ = offsetPtr<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+}
+
+IoUring::~IoUring()
+{
+    munmap(sqes_, sqes_size_);
+    munmap(sq_ring_, sq_ring_size_);
+    close(fd_);
+}
+
+io_uring_sqe *IoUring::getSqe()
+{
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_entries_)
+        return nullptr;
+    io_uring_sqe *sqe = &sqes_[sqe_tail_ & sq_mask_];
+    ++sqe_tail_;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+unsigned IoUring::sqSpaceLeft() const
+{
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    return sq_entries_ - (sqe_tail_ - head);
+}
+
+int IoUring::submitAndWait(bool wait, int timeout_ms)
+{
+    // Publish SQEs handed out since the last submit
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+    unsigned to_submit = sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+
+    unsigned flags = 0;
+    unsigned min_complete = 0;
+    const void *arg = nullptr;
+    size_t arg_size = 0;
+    io_uring_getevents_arg ext_arg;
+    __kernel_timespec ts;
+    if (wait)
+    {
+        flags |= IORING_ENTER_GETEVENTS;
+        min_complete = 1;
+        if (timeout_ms >= 0)
+        {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+            memset(&ext_arg, 0, sizeof(ext_arg));
+            ext_arg.ts = reinterpret_cast<uint64_t>(&ts);
+            flags |= IORING_ENTER_EXT_ARG;
+            arg = &ext_arg;
+            arg_size = sizeof(ext_arg);
+        }
+    }
+
+    if (to_submit == 0 && !wait)
+        return 0;
+
+    ++enter_calls_;
+    int ret = sysEnter(fd_, to_submit, min_complete, flags, arg, arg_size);
+    if (ret < 0 && (errno == ETIME || errno == EINTR))
+        return 0;
+    return ret < 0 ? -1 : 0;
+}
+
+io_uring_cqe *IoUring::peekCqe()
+{
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+        return nullptr;
+    return &cqes_[head & cq_mask_];
+}
+
+void IoUring::seenCqe()
+{
+    __atomic_store_n(cq_head_, *cq_head_ + 1, __ATOMIC_RELEASE);
+}
+
+io_uring_sqe *IoUring::prepRecvMultishot(int fd, uint16_t buffer_group, uint64_t user_data)
+{
+    io_uring_sqe *sqe = getSqe();
+    if (!sqe)
+        return nullptr;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffer_group;
+    sqe->user_data = user_data;
+    return sqe;
+}
+
+io_uring_sqe *IoUring::prepSendMsg(int fd, const msghdr *msg, uint64_t user_data)
+{
+    io_uring_sqe *sqe = getSqe();
+    if (!sqe)
+        return nullptr;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->len = 1;
+    sqe->user_data = user_data;
+    return sqe;
+}
+
+io_uring_sqe *IoUring::prepPollAdd(int fd, unsigned poll_mask, uint64_t user_data)
+{
+    io_uring_sqe *sqe = getSqe();
+    if (!sqe)
+        return nullptr;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = poll_mask;
+    sqe->user_data = user_data;
+    return sqe;
+}
+
+void IoUring::linkNext(io_uring_sqe *sqe)
+{
+    sqe->flags |= IOSQE_IO_LINK;
+}
+
+int IoUring::getFd() const
+{
+    return fd_;
+}
+
+uint64_t IoUring::enterCalls() const
+{
+    return enter_calls_;
+}
+
+// --- Provided buffer ring ---
+
+IoUringBufferRing::IoUringBufferRing(IoUring &ring, uint16_t group_id, unsigned count, size_t buffer_size)
+    : group_id_(group_id), count_(count), mask_(count - 1), buffer_size_(buffer_size),
+      ring_(nullptr), ring_size_(count * sizeof(io_uring_buf)), tail_(0)
+{
+    if (count == 0 || count > 32768 || (count & (count - 1)) != 0)
+        throw std::runtime_error("io_uring: buffer ring size must be a power of two <= 32768");
+
+    storage_.resize(count * buffer_size);
+    for (unsigned bid = 0; bid < count; ++bid)
+        buffers_.push_back(storage_.data() + static_cast<size_t>(bid) * buffer_size);
+    registerRing(ring);
+}
+
+IoUringBufferRing::IoUringBufferRing(IoUring &ring, uint16_t group_id, unsigned count, BufferPool &pool, size_t buffer_size)
+    : group_id_(group_id), count_(count), mask_(count - 1), buffer_size_(buffer_size),
+      ring_(nullptr), ring_size_(count * sizeof(io_uring_buf)), tail_(0)
+{
+    if (count == 0 || count > 32768 || (count & (count - 1)) != 0)
+        throw std::runtime_error("io_uring: buffer ring size must be a power of two <= 32768");
+    if (buffer_size > pool.bufferSize())
+        throw std::runtime_error("io_uring: buffer size exceeds pool buffer size");
+
+    for (unsigned bid = 0; bid < count; ++bid)
+    {
+        PoolBuffer buffer = pool.acquire();
+        if (!buffer)
+            throw std::runtime_error("io_uring: buffer pool exhausted");
+        buffers_.push_back(buffer.data());
+        pool_buffers_.push_back(std::move(buffer));
+    }
+    registerRing(ring);
+}
+
+void IoUringBufferRing::registerRing(IoUring &ring)
+{
+    // The ring itself must be page aligned
+    void *mem = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        throw std::runtime_error("io_uring: failed to allocate buffer ring");
+    ring_ = static_cast<io_uring_buf_ring *>(mem);
+    // Fault the pages in before the kernel pins them (an untouched mapping would pin the zero page)
+    memset(ring_, 0, ring_size_);
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring_);
+    reg.ring_entries = count_;
+    reg.bgid = group_id_;
+    if (sysRegister(ring.getFd(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        int err = errno;
+        munmap(ring_, ring_size_);
+        throw std::runtime_error(std::string("io_uring: buffer ring registration failed: ") + strerror(err));
+    }
+
+    for (unsigned bid = 0; bid < count_; ++bid)
+        recycle(static_cast<uint16_t>(bid));
+}
+
+IoUringBufferRing::~IoUringBufferRing()
+{
+    munmap(ring_, ring_size_);
+}
+
+uint16_t IoUringBufferRing::groupId() const
+{
+    return group_id_;
+}
+
+unsigned IoUringBufferRing::count() const
+{
+    return count_;
+}
+
+size_t IoUringBufferRing::bufferSize() const
+{
+    return buffer_size_;
+}
+
+uint8_t *IoUringBufferRing::buffer(uint16_t bid)
+{
+    return buffers_[bid];
+}
+
+void IoUringBufferRing::recycle(uint16_t bid)
+{
+    // bufs[0].resv overlays the ring tail, so only addr/len/bid are written. The entries
+    // are indexed from the ring base: in C++ the header's flexible array member is
+    // padded past the start of the union and ring_->bufs points 8 bytes too far.
+    io_uring_buf *buf = reinterpret_cast<io_uring_buf *>(ring_) + (tail_ & mask_);
+    buf->addr = reinterpret_cast<uint64_t>(buffer(bid));
+    buf->len = static_cast<uint32_t>(buffer_size_);
+    buf->bid = bid;
+    ++tail_;
+    __atomic_store_n(&ring_->tail, tail_, __ATOMIC_RELEASE);
+}
+
+#else // !FSL_HAVE_IO_URING
+
+IoUring::IoUring(unsigned)
+{
+    throw std::runtime_error("io_uring: not available in this build");
+}
+IoUring::~IoUring() {}
+io_uring_sqe *IoUring::getSqe() { return nullptr; }
+unsigned IoUring::sqSpaceLeft() const { return 0; }
+int IoUring::submitAndWait(bool, int) { return -1; }
+io_uring_cqe *IoUring::peekCqe() { return nullptr; }
+void IoUring::seenCqe() {}
+io_uring_sqe *IoUring::prepRecvMultishot(int, uint16_t, uint64_t) { return nullptr; }
+io_uring_sqe *IoUring::prepSendMsg(int, const msghdr *, uint64_t) { return nullptr; }
+io_uring_sqe *IoUring::prepPollAdd(int, unsigned, uint64_t) { return nullptr; }
+void IoUring::linkNext(io_uring_sqe *) {}
+int IoUring::getFd() const { return -1; }
+uint64_t IoUring::enterCalls() const { return 0; }
+
+IoUringBufferRing::IoUringBufferRing(IoUring &, uint16_t, unsigned, size_t)
+{
+    throw std::runtime_error("io_uring: not available in this build");
+}
+IoUringBufferRing::IoUringBufferRing(IoUring &, uint16_t, unsigned, BufferPool &, size_t)
+{
+    throw std::runtime_error("io_uring: not available in this build");
+}
+IoUringBufferRing::~IoUringBufferRing() {}
+uint16_t IoUringBufferRing::groupId() const { return 0; }
+unsigned IoUringBufferRing::count() const { return 0; }
+size_t IoUringBufferRing::bufferSize() const { return 0; }
+uint8_t *IoUringBufferRing::buffer(uint16_t) { return nullptr; }
+void IoUringBufferRing::recycle(uint16_t) {}
+
+#endif // FSL_HAVE_IO_URING
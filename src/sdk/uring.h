@@ -0,0 +1,152 @@
+// uring.h - Minimal io_uring wrapper (raw syscalls, no liburing)
+//
+// IoUring owns one submission/completion ring pair. It exposes just what the FSL
+// event loop needs:
+//   - getSqe()/submitAndWait(): queue SQEs and submit them with one io_uring_enter(),
+//     optionally waiting for completions in the same call
+//   - peekCqe()/seenCqe(): consume completions without a syscall
+//   - prepRecvMultishot(), prepSendMsg(), prepPollAdd(): SQE helpers
+//   - linkNext(): chain an SQE to the one queued after it (ordered execution)
+//
+// IoUringBufferRing registers a provided buffer ring (IORING_REGISTER_PBUF_RING):
+// a fixed set of equally sized buffers the kernel picks from for multishot
+// receives. Completed buffers are handed back with recycle(). The buffers are
+// either owned by the ring or drawn from a BufferPool.
+//
+// Requirements: Linux 6.0+ (multishot recv, provided buffer rings, IORING_ENTER_EXT_ARG).
+// On older kernels, or when built against headers without io_uring support, the
+// constructors throw std::runtime_error so the caller can fall back to poll/epoll.
+//
+// The buffer ring's memory must stay valid while the kernel may use it: destroy the
+// IoUring (which cancels in-flight requests) before its buffer rings.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <sys/socket.h>
+#include "buffer_pool.h"
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#ifdef IORING_RECV_MULTISHOT
+#define FSL_HAVE_IO_URING 1
+#else
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+#endif
+
+// IoUring: single-issuer io_uring instance
+class IoUring
+{
+public:
+    // Constructor: create a ring with at least entries SQEs (throws std::runtime_error)
+    explicit IoUring(unsigned entries);
+
+    // Destructor: unmaps and closes the ring (in-flight requests are cancelled)
+    ~IoUring();
+
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    // Next free SQE (zeroed), or nullptr if the submission queue is full
+    io_uring_sqe *getSqe();
+
+    // Number of SQEs that can still be queued before the next submit
+    unsigned sqSpaceLeft() const;
+
+    // Submit queued SQEs; if wait is true, block until at least one CQE is available
+    // or timeout_ms expires (-1 = no timeout). Returns 0 on success (including timeout
+    // and EINTR), -1 on error (errno set)
+    int submitAndWait(bool wait, int timeout_ms);
+
+    // Oldest unconsumed CQE, or nullptr if none
+    io_uring_cqe *peekCqe();
+
+    // Mark the CQE returned by peekCqe() as consumed
+    void seenCqe();
+
+    // SQE helpers: return the queued SQE, or nullptr if the submission queue is full
+    io_uring_sqe *prepRecvMultishot(int fd, uint16_t buffer_group, uint64_t user_data);
+    io_uring_sqe *prepSendMsg(int fd, const msghdr *msg, uint64_t user_data);
+    io_uring_sqe *prepPollAdd(int fd, unsigned poll_mask, uint64_t user_data);
+
+    // Make the SQE queued right after sqe start only once sqe has completed (IOSQE_IO_LINK)
+    static void linkNext(io_uring_sqe *sqe);
+
+    // Ring file descriptor (for buffer ring registration)
+    int getFd() const;
+
+    // Number of io_uring_enter() calls made (for benchmarking against poll/epoll)
+    uint64_t enterCalls() const;
+
+private:
+    int fd_;
+    void *sq_ring_;
+    void *cq_ring_;
+    size_t sq_ring_size_;
+    size_t cq_ring_size_;
+    io_uring_sqe *sqes_;
+    size_t sqes_size_;
+
+    unsigned *sq_head_;
+    unsigned *sq_tail_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    unsigned sqe_tail_; // local tail: SQEs handed out by getSqe()
+
+    unsigned *cq_head_;
+    unsigned *cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe *cqes_;
+
+    uint64_t enter_calls_;
+};
+
+// IoUringBufferRing: provided buffer ring for multishot receives
+class IoUringBufferRing
+{
+public:
+    // Constructor: register count buffers (power of two, <= 32768) of buffer_size bytes
+    // as buffer group group_id (throws std::runtime_error)
+    IoUringBufferRing(IoUring &ring, uint16_t group_id, unsigned count, size_t buffer_size);
+
+    // Constructor: as above, with the buffers taken from pool (buffer_size must fit in
+    // one pool buffer; throws std::runtime_error if the pool is exhausted)
+    IoUringBufferRing(IoUring &ring, uint16_t group_id, unsigned count, BufferPool &pool, size_t buffer_size);
+
+    // Destructor: unmaps the ring memory (the registration ends with the IoUring)
+    ~IoUringBufferRing();
+
+    IoUringBufferRing(const IoUringBufferRing &) = delete;
+    IoUringBufferRing &operator=(const IoUringBufferRing &) = delete;
+
+    uint16_t groupId() const;
+    unsigned count() const;
+    size_t bufferSize() const;
+
+    // Start of buffer bid
+    uint8_t *buffer(uint16_t bid);
+
+    // Give buffer bid back to the kernel
+    void recycle(uint16_t bid);
+
+private:
+    void registerRing(IoUring &ring);
+
+    uint16_t group_id_;
+    unsigned count_;
+    unsigned mask_;
+    size_t buffer_size_;
+    io_uring_buf_ring *ring_;
+    size_t ring_size_;
+    uint16_t tail_;
+    std::vector<uint8_t> storage_;         // own buffers
+    std::vector<PoolBuffer> pool_buffers_; // pool buffers
+    std::vector<uint8_t *> buffers_;       // start of buffer bid
+};
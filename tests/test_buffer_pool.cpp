@@ -0,0 +1,98 @@
+#include "catch.hpp"
+#include "buffer_pool.h"
+#include "msg_batch.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+TEST_CASE("BufferPool hands out every buffer once and reports exhaustion", "[buffer_pool]")
+{
+    BufferPool pool(4, 1000);
+    REQUIRE(pool.capacity() == 4);
+    REQUIRE(pool.bufferSize() == 1000);
+    REQUIRE(pool.slabBytes() >= 4 * 1000);
+
+    std::vector<PoolBuffer> held;
+    for (int i = 0; i < 4; ++i)
+    {
+        PoolBuffer buf = pool.acquire();
+        REQUIRE(buf);
+        REQUIRE(buf.capacity() == 1000);
+        REQUIRE(buf.length() == 0);
+        for (const PoolBuffer &other : held)
+            REQUIRE(other.data() != buf.data());
+        held.push_back(std::move(buf));
+    }
+    REQUIRE(pool.available() == 0);
+    REQUIRE(!pool.acquire());
+    REQUIRE(pool.exhausted() == 1);
+
+    held.pop_back();
+    REQUIRE(pool.available() == 1);
+    REQUIRE(pool.acquire());
+}
+
+TEST_CASE("PoolBuffer copies share the buffer until the last handle is gone", "[buffer_pool]")
+{
+    BufferPool pool(2, 64);
+    PoolBuffer a = pool.acquire();
+    memcpy(a.data(), "abc", 3);
+    a.setLength(3);
+
+    PoolBuffer b = a;
+    REQUIRE(b.data() == a.data());
+    REQUIRE(b.length() == 3);
+    a.reset();
+    REQUIRE(!a);
+    REQUIRE(pool.available() == 1);
+
+    PoolBuffer c = std::move(b);
+    REQUIRE(!b);
+    REQUIRE(memcmp(c.data(), "abc", 3) == 0);
+    c = PoolBuffer();
+    REQUIRE(pool.available() == 2);
+}
+
+TEST_CASE("BufferPool acquire/release is safe across threads", "[buffer_pool]")
+{
+    BufferPool pool(8, 64);
+    std::atomic<bool> corrupted(false);
+    auto worker = [&](uint8_t tag)
+    {
+        for (int i = 0; i < 20000; ++i)
+        {
+            PoolBuffer buf = pool.acquire();
+            if (!buf)
+                continue;
+            // A buffer owned by this thread must not change under it
+            memset(buf.data(), tag, 64);
+            for (int k = 0; k < 64; ++k)
+            {
+                if (buf.data()[k] != tag)
+                    corrupted = true;
+            }
+        }
+    };
+    std::thread t1(worker, 1), t2(worker, 2), t3(worker, 3);
+    t1.join();
+    t2.join();
+    t3.join();
+    REQUIRE(!corrupted);
+    REQUIRE(pool.available() == 8);
+}
+
+TEST_CASE("MsgBatch draws its buffers from a BufferPool", "[buffer_pool]")
+{
+    BufferPool pool(3, 128);
+    {
+        MsgBatch batch(pool, 2, 100);
+        REQUIRE(pool.available() == 1);
+        REQUIRE(batch.capacity() == 2);
+        REQUIRE(batch.bufferSize() == 100);
+        REQUIRE(batch.data(0) != batch.data(1));
+        REQUIRE_THROWS(MsgBatch(pool, 2, 100));
+        REQUIRE_THROWS(MsgBatch(pool, 1, 200));
+    }
+    REQUIRE(pool.available() == 3);
+}
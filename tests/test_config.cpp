@@ -24,4 +24,7 @@ TEST_CASE("Config parsing: minimal valid config", "[config]")
     REQUIRE(cfg.uds_clients.size() > 0);
     REQUIRE(cfg.ul_uds_mapping.size() > 0);
     REQUIRE(cfg.ctrl_uds_name.size() > 0);
+    REQUIRE((cfg.event_loop_threading == "single" || cfg.event_loop_threading == "split"));
+    for (const auto &server : cfg.uds_servers)
+        REQUIRE((server.framing == "raw" || server.framing == "fcom_datalink"));
 }
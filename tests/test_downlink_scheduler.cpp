@@ -0,0 +1,136 @@
+#include "catch.hpp"
+#include "../src/app.h"
+#include "test_utils.h"
+#include <string>
+#include <vector>
+
+// Exposes the downlink scheduler of shard 0
+struct SchedulerTestApp : public App
+{
+    explicit SchedulerTestApp(const AppConfig &config) : App(config) {}
+
+    // Mark every server readable (as the event loop would) and run one scheduling pass
+    void scheduleAll()
+    {
+        DownlinkShard &shard = *dl_shards_[0];
+        for (auto &server : shard.servers)
+            server.ready = true;
+        scheduleDownlink(shard);
+        shard.egress->flush();
+    }
+};
+
+static AppConfig schedulerConfig(int low_priority, int low_weight, int high_priority, int high_weight)
+{
+    AppConfig cfg = load_config(get_test_config_path().c_str(), -1);
+    cfg.event_loop_downlink_shards = 1;
+    cfg.udp_send_batch_delay_us = 0;
+    for (auto &server : cfg.uds_servers)
+    {
+        server.shard = 0;
+        server.priority = 0;
+        server.weight = 1;
+        server.batch_size = 8;
+        if (server.name == "FSW_LOW_DL")
+        {
+            server.priority = low_priority;
+            server.weight = low_weight;
+        }
+        else if (server.name == "FSW_HIGH_DL")
+        {
+            server.priority = high_priority;
+            server.weight = high_weight;
+        }
+    }
+    return cfg;
+}
+
+static std::string serverPath(const AppConfig &cfg, const std::string &name)
+{
+    for (const auto &server : cfg.uds_servers)
+        if (server.name == name)
+            return server.path;
+    return "";
+}
+
+// Payload letters of every datagram that reached the GSL endpoint, in order
+static std::string receivedOrder(UdpServerSocket &gsl)
+{
+    std::string order;
+    MsgBatch batch(64, 256);
+    int n;
+    while ((n = gsl.receiveBatch(batch)) > 0)
+    {
+        for (int k = 0; k < n; ++k)
+            order += static_cast<char>(batch.data(k)[GSL_FSL_HEADER_SIZE]);
+    }
+    return order;
+}
+
+TEST_CASE("Downlink scheduler drains higher priority servers first", "[downlink_scheduler]")
+{
+    AppConfig cfg = schedulerConfig(0, 1, 1, 1);
+    SchedulerTestApp app(cfg);
+    UdpServerSocket gsl(cfg.udp_remote_port, "127.0.0.1", cfg.udp_local_port);
+    REQUIRE(gsl.bindSocket());
+
+    // Low priority data is queued first
+    UdsSocket low("", serverPath(cfg, "FSW_LOW_DL"));
+    UdsSocket high("", serverPath(cfg, "FSW_HIGH_DL"));
+    for (int i = 0; i < 3; ++i)
+        REQUIRE(low.send("L", 1) == 1);
+    for (int i = 0; i < 3; ++i)
+        REQUIRE(high.send("H", 1) == 1);
+
+    app.scheduleAll();
+    REQUIRE(receivedOrder(gsl) == "HHHLLL");
+}
+
+TEST_CASE("Downlink scheduler shares a priority level by weight", "[downlink_scheduler]")
+{
+    // Same level: served in config order (FSW_HIGH_DL, then FSW_LOW_DL)
+    AppConfig cfg = schedulerConfig(0, 2, 0, 1);
+    SchedulerTestApp app(cfg);
+    UdpServerSocket gsl(cfg.udp_remote_port, "127.0.0.1", cfg.udp_local_port);
+    REQUIRE(gsl.bindSocket());
+
+    UdsSocket low("", serverPath(cfg, "FSW_LOW_DL"));
+    UdsSocket high("", serverPath(cfg, "FSW_HIGH_DL"));
+    for (int i = 0; i < 10; ++i)
+    {
+        REQUIRE(low.send("L", 1) == 1);
+        REQUIRE(high.send("H", 1) == 1);
+    }
+
+    // Round 1: weight 1 takes one quantum, weight 2 two quanta (all it has); round 2: the rest
+    const std::string quantum(App::DRR_QUANTUM_DATAGRAMS, 'H');
+    app.scheduleAll();
+    REQUIRE(receivedOrder(gsl) == quantum + std::string(10, 'L') + std::string(10 - quantum.size(), 'H'));
+}
+
+TEST_CASE("Downlink framing is bound per server from config", "[downlink_scheduler]")
+{
+    AppConfig cfg = load_config(get_test_config_path().c_str(), -1);
+    size_t low = 0;
+    for (size_t i = 0; i < cfg.uds_servers.size(); ++i)
+    {
+        if (cfg.uds_servers[i].name == "FSW_LOW_DL")
+            low = i;
+    }
+    REQUIRE(cfg.uds_servers[low].framing == "raw");
+
+    // The framing comes from the attribute, not from the server name
+    cfg.uds_servers[low].framing = "fcom_datalink";
+    {
+        App app(cfg);
+        std::vector<uint8_t> msg(FCOM_DATALINK_HEADER_SIZE + 5, 0);
+        std::atomic<uint32_t> seq_id{10};
+        GslFslHeader hdr;
+        REQUIRE(app.frameDownlink(low, msg.data(), msg.size(), hdr, seq_id) == (int)FCOM_DATALINK_HEADER_SIZE);
+        REQUIRE(hdr.length == 5);
+        REQUIRE(hdr.seq_id == 10);
+    }
+
+    cfg.uds_servers[low].framing = "json";
+    REQUIRE_THROWS(App(cfg));
+}
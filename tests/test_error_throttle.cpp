@@ -0,0 +1,53 @@
+#include "catch.hpp"
+#include "error_throttle.h"
+#include "logger.h"
+#include "test_utils.h"
+#include <cerrno>
+#include <string>
+
+TEST_CASE("ErrorThrottle logs the first failure, then one summary per interval", "[error_throttle]")
+{
+    Logger::setLevel(LogLevel::INFO);
+    const int64_t t0 = 1000000000;
+    std::string text;
+    {
+        CaptureOutput capture;
+        {
+            ErrorThrottle throttle("UDS send failed", "DL_EL_H");
+            throttle.report(EAGAIN, 1, t0);
+            // Within the interval: counted only
+            for (int i = 1; i <= 48212; ++i)
+                throttle.report(EAGAIN, 1, t0 + i * 10000);
+            REQUIRE(throttle.total() == 48213);
+            throttle.report(EAGAIN, 1, t0 + 1500000000);
+            // Still pending when the throttle goes away: reported on destruction
+            throttle.report(ECONNREFUSED, 7, t0 + 1600000000);
+            REQUIRE(throttle.total() == 48221);
+        }
+        text = capture.text();
+    }
+    REQUIRE(countOccurrences(text, "[ERROR] - UDS send failed on DL_EL_H: EAGAIN\n") == 1);
+    REQUIRE(countOccurrences(text, "[ERROR] - UDS send failed on DL_EL_H: EAGAIN x 48213 in last 1.5s\n") == 1);
+    REQUIRE(countOccurrences(text, "[ERROR] - UDS send failed on DL_EL_H: ECONNREFUSED x 7 in last ") == 1);
+    REQUIRE(countOccurrences(text, "UDS send failed") == 3);
+
+    {
+        CaptureOutput capture;
+        {
+            ErrorThrottle throttle("Downlink egress queue full, datagrams dropped");
+            throttle.report(0, 3, t0);
+            throttle.report(0, 4, t0 + 1);
+        }
+        text = capture.text();
+    }
+    REQUIRE(countOccurrences(text, "[ERROR] - Downlink egress queue full, datagrams dropped: x 3\n") == 1);
+    REQUIRE(countOccurrences(text, "[ERROR] - Downlink egress queue full, datagrams dropped: x 4") == 1);
+}
+
+TEST_CASE("ErrorThrottle names common errno values", "[error_throttle]")
+{
+    REQUIRE(ErrorThrottle::errnoName(EAGAIN) == "EAGAIN");
+    REQUIRE(ErrorThrottle::errnoName(ENOBUFS) == "ENOBUFS");
+    REQUIRE(ErrorThrottle::errnoName(ECONNREFUSED) == "ECONNREFUSED");
+    REQUIRE_FALSE(ErrorThrottle::errnoName(ENOSPC).empty());
+}
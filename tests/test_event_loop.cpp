@@ -0,0 +1,267 @@
+#include "catch.hpp"
+#include "event_loop.h"
+#include "../src/app.h"
+#include "test_utils.h"
+#include <cstdint>
+#include <arpa/inet.h>
+#include <cstring>
+#include <map>
+#include <poll.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Exposes the App event loops and the shutdown eventfd they watch
+struct LoopTestApp : public App
+{
+    using App::runReadinessLoop;
+    using App::runUringLoop;
+    explicit LoopTestApp(const AppConfig &config) : App(config) {}
+
+    // What signalHandler() writes, without setting shutdown_flag_
+    static void wakeLoops()
+    {
+        uint64_t one = 1;
+        REQUIRE(write(shutdown_event_fd_, &one, sizeof(one)) == sizeof(one));
+    }
+    // The loops never drain the eventfd: reset it for the next test
+    static void resetShutdownEvent()
+    {
+        uint64_t value;
+        REQUIRE(read(shutdown_event_fd_, &value, sizeof(value)) == sizeof(value));
+    }
+};
+
+// Wait up to 2 s for fd to become readable
+static bool waitReadable(int fd)
+{
+    pollfd pfd = {fd, POLLIN, 0};
+    return poll(&pfd, 1, 2000) == 1;
+}
+
+TEST_CASE("EventLoop dispatches only ready fds to their handlers", "[event_loop]")
+{
+    EventLoopBackend backend = GENERATE(EventLoopBackend::POLL, EventLoopBackend::EPOLL);
+    std::unique_ptr<EventLoop> loop = EventLoop::create(backend);
+
+    int pipe_a[2], pipe_b[2];
+    REQUIRE(pipe(pipe_a) == 0);
+    REQUIRE(pipe(pipe_b) == 0);
+
+    std::vector<int> fired;
+    CallbackHandler handler_a([&](uint32_t events)
+                              { REQUIRE((events & EVENT_READ)); fired.push_back(0); });
+    CallbackHandler handler_b([&](uint32_t events)
+                              { REQUIRE((events & EVENT_READ)); fired.push_back(1); });
+    REQUIRE(loop->add(pipe_a[0], EVENT_READ, &handler_a));
+    REQUIRE(loop->add(pipe_b[0], EVENT_READ, &handler_b));
+
+    // Nothing ready: times out without dispatching
+    REQUIRE(loop->runOnce(0) == 0);
+    REQUIRE(fired.empty());
+
+    REQUIRE(write(pipe_b[1], "x", 1) == 1);
+    REQUIRE(loop->runOnce(100) == 1);
+    REQUIRE(fired == std::vector<int>{1});
+
+    REQUIRE(loop->remove(pipe_b[0]));
+    fired.clear();
+    REQUIRE(loop->runOnce(0) == 0);
+    REQUIRE(fired.empty());
+
+    for (int fd : {pipe_a[0], pipe_a[1], pipe_b[0], pipe_b[1]})
+        close(fd);
+}
+
+TEST_CASE("EventLoop modify toggles write interest", "[event_loop]")
+{
+    EventLoopBackend backend = GENERATE(EventLoopBackend::POLL, EventLoopBackend::EPOLL);
+    std::unique_ptr<EventLoop> loop = EventLoop::create(backend);
+
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+
+    uint32_t seen = 0;
+    CallbackHandler handler([&](uint32_t events)
+                            { seen |= events; });
+    REQUIRE(loop->add(fds[1], 0, &handler));
+    REQUIRE(loop->runOnce(0) == 0);
+
+    REQUIRE(loop->modify(fds[1], EVENT_WRITE));
+    REQUIRE(loop->runOnce(100) == 1);
+    REQUIRE((seen & EVENT_WRITE));
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_CASE("parseEventLoopBackend accepts known names only", "[event_loop]")
+{
+    EventLoopBackend backend;
+    REQUIRE(parseEventLoopBackend("poll", backend));
+    REQUIRE(backend == EventLoopBackend::POLL);
+    REQUIRE(parseEventLoopBackend("epoll", backend));
+    REQUIRE(backend == EventLoopBackend::EPOLL);
+    REQUIRE(!parseEventLoopBackend("select", backend));
+}
+
+TEST_CASE("io_uring loop exits on the shutdown eventfd while idle", "[event_loop]")
+{
+    AppConfig cfg = load_config(get_test_config_path().c_str(), -1);
+    cfg.event_loop_backend = "io_uring"; // sizes the buffer pool for the buffer rings
+    LoopTestApp app(cfg);
+
+    bool ran = true;
+    std::thread loop([&app, &ran]
+                     { ran = app.runUringLoop(); });
+    // No traffic: only the eventfd can end the wait in io_uring_enter()
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    LoopTestApp::wakeLoops();
+    loop.join();
+    LoopTestApp::resetShutdownEvent();
+    if (!ran)
+        WARN("io_uring not available, loop fell back before waiting");
+}
+
+TEST_CASE("UDP GSO is enabled by the readiness loop only", "[event_loop]")
+{
+    AppConfig cfg = load_config(get_test_config_path().c_str(), -1);
+    cfg.event_loop_backend = GENERATE(std::string("io_uring"), std::string("epoll"));
+    cfg.udp_gso_max_segments = 8;
+
+    CaptureOutput capture;
+    bool ran = false; // io_uring loop served the channels
+    {
+        LoopTestApp app(cfg);
+        std::thread loop([&app, &ran, &cfg]
+                         {
+                             if (cfg.event_loop_backend == "io_uring")
+                                 ran = app.runUringLoop();
+                             if (!ran)
+                                 app.runReadinessLoop(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        LoopTestApp::wakeLoops();
+        loop.join();
+        LoopTestApp::resetShutdownEvent();
+    }
+
+    std::string log = capture.text();
+    bool gso_log = log.find("UDP GSO enabled") != std::string::npos || log.find("UDP GSO not supported") != std::string::npos;
+    if (ran)
+    {
+        REQUIRE(log.find("UDP GSO is not used by the io_uring backend") != std::string::npos);
+        REQUIRE(!gso_log);
+    }
+    else
+    {
+        // epoll (or io_uring fallen back to it): the readiness loop sends through the egresses
+        REQUIRE(gso_log);
+    }
+}
+
+TEST_CASE("Split threading forwards both directions on separate loops and stops on the shutdown eventfd", "[event_loop]")
+{
+    AppConfig cfg = load_config(get_test_config_path().c_str(), -1);
+    cfg.event_loop_backend = "epoll";
+    cfg.event_loop_threading = "split";
+    const UdsServerConfig &server = cfg.uds_servers.back(); // raw framing
+    REQUIRE(server.name == "FSW_LOW_DL");
+    const uint16_t opcode = cfg.ul_uds_mapping.begin()->first;
+
+    UdpServerSocket gsl(cfg.udp_remote_port, cfg.udp_remote_ip, cfg.udp_local_port);
+    REQUIRE(gsl.bindSocket());
+    UdsSocket fsw_ul(cfg.uds_clients.at(cfg.ul_uds_mapping.begin()->second), "");
+    REQUIRE(fsw_ul.bindSocket());
+
+    CaptureOutput capture;
+    {
+        LoopTestApp app(cfg);
+        std::thread loop([&app]
+                         { app.runReadinessLoop(); });
+
+        // Downlink: UDS server -> GSL
+        UdsSocket fsw("", server.path);
+        REQUIRE(fsw.send("down", 4) == 4);
+        REQUIRE(waitReadable(gsl.getFd()));
+        uint8_t buf[256];
+        ssize_t n = recv(gsl.getFd(), buf, sizeof(buf), 0);
+        REQUIRE(n == static_cast<ssize_t>(GSL_FSL_HEADER_SIZE + 4));
+        REQUIRE(memcmp(buf + GSL_FSL_HEADER_SIZE, "down", 4) == 0);
+
+        // Uplink: GSL -> UDS client
+        GslFslHeader hdr = {};
+        hdr.opcode = opcode;
+        hdr.length = 2;
+        memcpy(buf, &hdr, GSL_FSL_HEADER_SIZE);
+        memcpy(buf + GSL_FSL_HEADER_SIZE, "up", 2);
+        REQUIRE(gsl.send(buf, GSL_FSL_HEADER_SIZE + 2) == static_cast<ssize_t>(GSL_FSL_HEADER_SIZE + 2));
+        REQUIRE(waitReadable(fsw_ul.getFd()));
+        char up[16];
+        n = fsw_ul.receive(up, sizeof(up));
+        REQUIRE(std::string(up, n > 0 ? n : 0) == "up");
+
+        // Both loop threads wake on the eventfd alone (shutdown_flag_ stays clear)
+        LoopTestApp::wakeLoops();
+        loop.join();
+        LoopTestApp::resetShutdownEvent();
+    }
+
+    std::string log = capture.text();
+    REQUIRE(log.find("Event loop backend: epoll (uplink)") != std::string::npos);
+    REQUIRE(log.find("Event loop backend: epoll (downlink)") != std::string::npos);
+    REQUIRE(log.find("Event loop stats (epoll, split): ") != std::string::npos);
+}
+
+TEST_CASE("Downlink shards send their servers' datagrams from their own socket", "[event_loop]")
+{
+    AppConfig cfg = load_config(get_test_config_path().c_str(), -1);
+    cfg.event_loop_backend = "epoll";
+    cfg.event_loop_downlink_shards = 3; // shard 2 gets no server
+    UdsServerConfig &sharded = cfg.uds_servers.back();
+    REQUIRE(sharded.name == "FSW_LOW_DL");
+    sharded.shard = 1;
+    const UdsServerConfig &unsharded = cfg.uds_servers[cfg.uds_servers.size() - 2];
+    REQUIRE(unsharded.name == "FSW_HIGH_DL");
+
+    UdpServerSocket gsl(cfg.udp_remote_port, cfg.udp_remote_ip, cfg.udp_local_port);
+    REQUIRE(gsl.bindSocket());
+
+    std::map<std::string, uint16_t> source_port; // payload -> UDP port it came from
+    CaptureOutput capture;
+    {
+        LoopTestApp app(cfg);
+        std::thread loop([&app]
+                         { app.runReadinessLoop(); });
+
+        UdsSocket shard1_writer("", sharded.path);
+        UdsSocket shard0_writer("", unsharded.path);
+        REQUIRE(shard1_writer.send("s1", 2) == 2);
+        REQUIRE(shard0_writer.send("s0", 2) == 2);
+        for (int i = 0; i < 2; ++i)
+        {
+            REQUIRE(waitReadable(gsl.getFd()));
+            uint8_t buf[256];
+            sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            ssize_t n = recvfrom(gsl.getFd(), buf, sizeof(buf), 0, reinterpret_cast<sockaddr *>(&from), &from_len);
+            REQUIRE(n == static_cast<ssize_t>(GSL_FSL_HEADER_SIZE + 2));
+            source_port[std::string(reinterpret_cast<char *>(buf) + GSL_FSL_HEADER_SIZE, 2)] = ntohs(from.sin_port);
+        }
+
+        LoopTestApp::wakeLoops();
+        loop.join();
+        LoopTestApp::resetShutdownEvent();
+    }
+
+    // Shard 0 sends on the FSL port, shard 1 on its own ephemeral port
+    REQUIRE(source_port.size() == 2);
+    REQUIRE(source_port["s0"] == cfg.udp_local_port);
+    REQUIRE(source_port["s1"] != cfg.udp_local_port);
+    REQUIRE(source_port["s1"] != 0);
+
+    std::string log = capture.text();
+    REQUIRE(log.find("Event loop backend: epoll (downlink shard 1)") != std::string::npos);
+    REQUIRE(log.find("Downlink shard 2 has no UDS servers, not started") != std::string::npos);
+    REQUIRE(log.find("(downlink shard 2)") == std::string::npos);
+}
@@ -67,26 +67,26 @@ TEST_CASE("FSL state changes to OPER and STANDBY via FSW ctrl requests", "[ctrl_
 
     // Set OPER
     auto req_oper = make_fsw_ctrl_req(FSL_CTRL_OP_SET_OPER, 42);
-    app.processFSWCtrlRequest(req_oper);
+    app.processFSWCtrlRequest(req_oper.data(), req_oper.size());
     auto resp_oper = parse_gen_resp(last_response);
     REQUIRE(resp_oper.header.ctrl_opcode == FSL_CTRL_OP_SET_OPER);
     REQUIRE(resp_oper.header.ctrl_error_code == FSL_CTRL_ERR_NONE);
     // Check CBIT state is OPER
     auto req_cbit = make_fsw_ctrl_req(FSL_CTRL_OP_GET_CBIT, 43);
-    app.processFSWCtrlRequest(req_cbit);
+    app.processFSWCtrlRequest(req_cbit.data(), req_cbit.size());
     auto resp_cbit = parse_cbit_resp(last_response);
     REQUIRE(resp_cbit.header.ctrl_opcode == FSL_CTRL_OP_GET_CBIT);
     REQUIRE(resp_cbit.state == FSL_STATE_OPER);
 
     // Set STANDBY
     auto req_standby = make_fsw_ctrl_req(FSL_CTRL_OP_SET_STANDBY, 44);
-    app.processFSWCtrlRequest(req_standby);
+    app.processFSWCtrlRequest(req_standby.data(), req_standby.size());
     auto resp_standby = parse_gen_resp(last_response);
     REQUIRE(resp_standby.header.ctrl_opcode == FSL_CTRL_OP_SET_STANDBY);
     REQUIRE(resp_standby.header.ctrl_error_code == FSL_CTRL_ERR_NONE);
     // Check CBIT state is STANDBY
     req_cbit = make_fsw_ctrl_req(FSL_CTRL_OP_GET_CBIT, 45);
-    app.processFSWCtrlRequest(req_cbit);
+    app.processFSWCtrlRequest(req_cbit.data(), req_cbit.size());
     resp_cbit = parse_cbit_resp(last_response);
     REQUIRE(resp_cbit.header.ctrl_opcode == FSL_CTRL_OP_GET_CBIT);
     REQUIRE(resp_cbit.state == FSL_STATE_STANDBY);
@@ -0,0 +1,74 @@
+#include "catch.hpp"
+#include "latency_histogram.h"
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+TEST_CASE("LatencyHistogram buckets are at most 12.5% wide", "[latency_histogram]")
+{
+    const uint64_t values[] = {0, 1, 7, 8, 9, 15, 16, 17, 100, 1000, 12345, 999999, 1000000007ull, 123456789012ull};
+    for (uint64_t value : values)
+    {
+        size_t index = LatencyHistogram::bucketIndex(value);
+        REQUIRE(index < LatencyHistogram::BUCKETS);
+        uint64_t upper = LatencyHistogram::bucketUpperNs(index);
+        REQUIRE(upper >= value);
+        REQUIRE(upper - value <= value / LatencyHistogram::SUB_BUCKETS);
+        // The bucket below ends just before this one starts
+        if (index > 0)
+            REQUIRE(LatencyHistogram::bucketUpperNs(index - 1) < value);
+    }
+
+    // Longer than trackable: counted in the last bucket
+    REQUIRE(LatencyHistogram::bucketIndex(UINT64_MAX) == LatencyHistogram::BUCKETS - 1);
+    REQUIRE(LatencyHistogram::bucketUpperNs(LatencyHistogram::BUCKETS - 1) == LatencyHistogram::MAX_TRACKABLE_NS);
+}
+
+TEST_CASE("LatencyHistogram reports percentiles, counts and the maximum", "[latency_histogram]")
+{
+    LatencyHistogram latency;
+    REQUIRE(latency.snapshot().percentile(0.5) == 0);
+
+    // 1..1000 us
+    for (int64_t us = 1; us <= 1000; ++us)
+        latency.record(us * 1000);
+    latency.record(-5); // clock stepped back: counted as 0
+
+    LatencyHistogram::Snapshot s = latency.snapshot();
+    REQUIRE(s.count == 1001);
+    REQUIRE(s.max_ns == 1000000);
+    REQUIRE(s.sum_ns == 500500000);
+    REQUIRE(s.percentile(0.0) == 0);
+    REQUIRE(s.percentile(1.0) == 1000000);
+
+    // Within a bucket width of the exact value
+    uint64_t p50 = s.percentile(0.5);
+    REQUIRE(p50 >= 500000);
+    REQUIRE(p50 <= 500000 + 500000 / LatencyHistogram::SUB_BUCKETS);
+    uint64_t p99 = s.percentile(0.99);
+    REQUIRE(p99 >= 990000);
+    REQUIRE(p99 <= 1000000);
+
+    // Exact at 2^n - 1 bucket boundaries: 0 plus 1..65 us
+    REQUIRE(s.countAtOrBelow((1u << 16) - 1) == 66);
+    REQUIRE(s.countAtOrBelow(LatencyHistogram::MAX_TRACKABLE_NS) == 1001);
+}
+
+TEST_CASE("LatencyHistogram records from several threads without losing values", "[latency_histogram]")
+{
+    LatencyHistogram latency;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&latency, t]
+                             {
+                                 for (int i = 0; i < 10000; ++i)
+                                     latency.record(1000 * (t + 1));
+                             });
+    for (auto &thread : threads)
+        thread.join();
+
+    LatencyHistogram::Snapshot s = latency.snapshot();
+    REQUIRE(s.count == 40000);
+    REQUIRE(s.max_ns == 4000);
+    REQUIRE(s.sum_ns == 10000ull * (1000 + 2000 + 3000 + 4000));
+}
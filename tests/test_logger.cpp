@@ -0,0 +1,111 @@
+#include "catch.hpp"
+#include "logger.h"
+#include "test_utils.h"
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+TEST_CASE("Async logger writes every record from every thread", "[logger]")
+{
+    Logger::setLevel(LogLevel::INFO);
+    uint64_t dropped = Logger::droppedRecords();
+    std::string text;
+    {
+        CaptureOutput capture;
+        Logger::startAsync(1024);
+        REQUIRE(Logger::isAsync());
+        auto produce = [](const char *tag)
+        {
+            for (int i = 0; i < 200; ++i)
+            {
+                Logger::info(std::string(tag) + " record " + std::to_string(i));
+                if (i % 50 == 0)
+                    std::this_thread::yield();
+            }
+        };
+        std::thread a(produce, "thread-a");
+        std::thread b(produce, "thread-b");
+        a.join();
+        b.join();
+        Logger::error("async error");
+        Logger::debug("filtered out");
+        Logger::stopAsync();
+        REQUIRE_FALSE(Logger::isAsync());
+        text = capture.text();
+    }
+
+    REQUIRE(Logger::droppedRecords() == dropped);
+    REQUIRE(countOccurrences(text, "[INFO] - thread-a record ") == 200);
+    REQUIRE(countOccurrences(text, "[INFO] - thread-b record ") == 200);
+    REQUIRE(countOccurrences(text, "[ERROR] - async error") == 1);
+    REQUIRE(countOccurrences(text, "filtered out") == 0);
+    // Records of one thread keep their order
+    REQUIRE(text.find("thread-a record 10\n") < text.find("thread-a record 11\n"));
+    REQUIRE(text.find("thread-b record 198\n") < text.find("thread-b record 199\n"));
+}
+
+TEST_CASE("Async logger drops and counts records when a ring is full", "[logger]")
+{
+    Logger::setLevel(LogLevel::INFO);
+    uint64_t dropped = Logger::droppedRecords();
+    const int total = 2000;
+    std::string text;
+    {
+        CaptureOutput capture;
+        Logger::startAsync(2);
+        for (int i = 0; i < total; ++i)
+            Logger::info("burst " + std::to_string(i));
+        Logger::stopAsync();
+        text = capture.text();
+    }
+
+    // Every record is either written or counted as dropped, and the drop is reported
+    uint64_t new_drops = Logger::droppedRecords() - dropped;
+    REQUIRE(new_drops > 0);
+    REQUIRE(countOccurrences(text, "[INFO] - burst ") + new_drops == static_cast<uint64_t>(total));
+    REQUIRE(text.find("record(s) dropped (ring full)") != std::string::npos);
+
+    // Back to synchronous logging: nothing is lost
+    {
+        CaptureOutput capture;
+        Logger::info("sync again");
+        REQUIRE(countOccurrences(capture.text(), "sync again") == 1);
+    }
+}
+
+// Needs INFO compiled in (the default for every build type)
+#if FSL_LOG_MIN_LEVEL >= FSL_LOG_LEVEL_INFO
+TEST_CASE("FSL_LOG macros format lazily and only for enabled levels", "[logger]")
+{
+    int evaluated = 0;
+    auto count = [&evaluated]()
+    {
+        return ++evaluated;
+    };
+
+    std::string text;
+    {
+        CaptureOutput capture;
+        Logger::setLevel(LogLevel::INFO);
+        FSL_LOG_DEBUG("debug %d", count());
+        FSL_LOG_INFO("info %d, server '%s', bytes=%zu", count(), "DL_EL_H", static_cast<size_t>(42));
+        FSL_LOG_ERROR("error %s", "EAGAIN");
+        text = capture.text();
+    }
+
+    // The disabled call did not evaluate its arguments
+    REQUIRE(evaluated == 1);
+    REQUIRE(countOccurrences(text, "debug") == 0);
+    REQUIRE(countOccurrences(text, "[INFO] - info 1, server 'DL_EL_H', bytes=42\n") == 1);
+    REQUIRE(countOccurrences(text, "[ERROR] - error EAGAIN\n") == 1);
+
+    // Long lines are truncated, not overrun
+    {
+        CaptureOutput capture;
+        FSL_LOG_INFO("%s", std::string(3 * Logger::LOGF_LINE_BYTES, 'x').c_str());
+        text = capture.text();
+    }
+    REQUIRE(countOccurrences(text, "x") == Logger::LOGF_LINE_BYTES - 1);
+}
+#endif
@@ -0,0 +1,92 @@
+#include "catch.hpp"
+#include "../src/app.h"
+#include "metrics_server.h"
+#include "test_utils.h"
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+// Send request to the metrics UDS and return the whole response (the server closes it)
+std::string httpRequest(const std::string &path, const std::string &request)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    REQUIRE(fd >= 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    REQUIRE(connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+    REQUIRE(send(fd, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size()));
+    std::string response;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+        response.append(buf, static_cast<size_t>(n));
+    close(fd);
+    return response;
+}
+} // namespace
+
+TEST_CASE("OpenMetricsText writes families, labels and the EOF marker", "[metrics]")
+{
+    OpenMetricsText text;
+    text.family("fsl_test", "counter", "Test counter");
+    text.sample("fsl_test_total", OpenMetricsText::labels({{"channel", "A\"b\\c\nd"}, {"opcode", "7"}}), static_cast<uint64_t>(42));
+    text.family("fsl_ratio", "gauge", "Test gauge");
+    text.sample("fsl_ratio", "", 0.25);
+    std::string out = text.finish();
+
+    REQUIRE(out == "# TYPE fsl_test counter\n"
+                   "# HELP fsl_test Test counter\n"
+                   "fsl_test_total{channel=\"A\\\"b\\\\c\\nd\",opcode=\"7\"} 42\n"
+                   "# TYPE fsl_ratio gauge\n"
+                   "# HELP fsl_ratio Test gauge\n"
+                   "fsl_ratio 0.25\n"
+                   "# EOF\n");
+}
+
+TEST_CASE("MetricsServer answers GET /metrics on its UDS", "[metrics]")
+{
+    const std::string path = "/tmp/fsl_test_metrics";
+    int renders = 0;
+    MetricsServer server(path, 0, [&renders]
+                         { ++renders; return std::string("fsl_up 1\n# EOF\n"); });
+    std::string error;
+    REQUIRE(server.start(error));
+
+    std::string response = httpRequest(path, "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    REQUIRE(response.rfind("HTTP/1.1 200 OK\r\n", 0) == 0);
+    REQUIRE(response.find(std::string("Content-Type: ") + MetricsServer::CONTENT_TYPE + "\r\n") != std::string::npos);
+    REQUIRE(response.find("Content-Length: 15\r\n") != std::string::npos);
+    REQUIRE(response.substr(response.size() - 15) == "fsl_up 1\n# EOF\n");
+
+    REQUIRE(httpRequest(path, "GET /other HTTP/1.1\r\n\r\n").rfind("HTTP/1.1 404", 0) == 0);
+    REQUIRE(httpRequest(path, "POST /metrics HTTP/1.1\r\n\r\n").rfind("HTTP/1.1 405", 0) == 0);
+    REQUIRE(renders == 1);
+    REQUIRE(server.requests() == 1);
+
+    server.stop();
+    REQUIRE(access(path.c_str(), F_OK) != 0);
+}
+
+TEST_CASE("App renders every channel counter in OpenMetrics format", "[metrics]")
+{
+    AppConfig cfg = load_config(get_test_config_path().c_str(), -1);
+    App app(cfg);
+    std::string text = app.renderMetrics();
+
+    REQUIRE(text.size() >= 6);
+    REQUIRE(text.substr(text.size() - 6) == "# EOF\n");
+    REQUIRE(countOccurrences(text, "# TYPE fsl_channel_datagrams counter\n") == 1);
+    size_t channels = cfg.uds_servers.size() + cfg.ul_uds_mapping.size() + cfg.ctrl_uds_name.size();
+    REQUIRE(countOccurrences(text, "fsl_channel_datagrams_total{") == channels);
+    REQUIRE(countOccurrences(text, "fsl_channel_drops_total{direction=\"downlink\"") == cfg.uds_servers.size());
+    REQUIRE(text.find("fsl_channel_bytes_total{direction=\"downlink\",channel=\"" + cfg.uds_servers[0].name + "\"} 0\n") != std::string::npos);
+    REQUIRE(text.find("fsl_uplink_unrouted_total 0\n") != std::string::npos);
+    REQUIRE(text.find("fsl_egress_queued_bytes{shard=\"0\"} 0\n") != std::string::npos);
+    REQUIRE(text.find("fsl_buffer_pool_capacity " + std::to_string(App::bufferPoolCapacity(cfg)) + "\n") != std::string::npos);
+}
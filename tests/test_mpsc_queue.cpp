@@ -0,0 +1,72 @@
+#include "catch.hpp"
+#include "mpsc_queue.h"
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_CASE("MpscQueue is FIFO and reports full and empty", "[mpsc_queue]")
+{
+    MpscQueue<std::unique_ptr<int>> queue(3);
+    REQUIRE(queue.capacity() == 3);
+
+    for (int round = 0; round < 4; ++round)
+    {
+        for (int i = 0; i < 3; ++i)
+            REQUIRE(queue.tryPush(std::unique_ptr<int>(new int(round * 10 + i))));
+        std::unique_ptr<int> extra(new int(-1));
+        REQUIRE_FALSE(queue.tryPush(std::move(extra)));
+        REQUIRE(extra); // untouched when full
+        REQUIRE(queue.size() == 3);
+
+        std::unique_ptr<int> value;
+        for (int i = 0; i < 3; ++i)
+        {
+            REQUIRE(queue.tryPop(value));
+            REQUIRE(*value == round * 10 + i);
+        }
+        REQUIRE_FALSE(queue.tryPop(value));
+        REQUIRE(queue.size() == 0);
+    }
+}
+
+TEST_CASE("MpscQueue delivers every value from concurrent producers in per-producer order", "[mpsc_queue]")
+{
+    const int producers = 4;
+    const int per_producer = 20000;
+    MpscQueue<int> queue(64);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&queue, p]
+                             {
+            for (int i = 0; i < per_producer; ++i)
+            {
+                int value = p * per_producer + i;
+                while (!queue.tryPush(std::move(value)))
+                    std::this_thread::yield();
+            } });
+    }
+
+    std::vector<int> next(producers, 0);
+    int received = 0;
+    int out_of_order = 0;
+    while (received < producers * per_producer)
+    {
+        int value;
+        if (!queue.tryPop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        int p = value / per_producer;
+        if (value % per_producer != next[p])
+            ++out_of_order;
+        ++next[p];
+        ++received;
+    }
+    for (auto &t : threads)
+        t.join();
+    REQUIRE(out_of_order == 0);
+    REQUIRE(queue.size() == 0);
+}
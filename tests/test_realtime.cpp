@@ -0,0 +1,58 @@
+#include "catch.hpp"
+#include "realtime.h"
+#include <sched.h>
+
+TEST_CASE("parseCpuList accepts single CPUs and ranges", "[realtime]")
+{
+    std::vector<int> cpus;
+    REQUIRE(parseCpuList("", cpus));
+    REQUIRE(cpus.empty());
+    REQUIRE(parseCpuList("2", cpus));
+    REQUIRE(cpus == std::vector<int>{2});
+    REQUIRE(parseCpuList("0-2,5", cpus));
+    REQUIRE(cpus == std::vector<int>{0, 1, 2, 5});
+
+    REQUIRE_FALSE(parseCpuList("x", cpus));
+    REQUIRE_FALSE(parseCpuList("3-1", cpus));
+    REQUIRE_FALSE(parseCpuList("1,", cpus));
+    REQUIRE_FALSE(parseCpuList("-1", cpus));
+}
+
+TEST_CASE("Scheduling policies and priority ranges", "[realtime]")
+{
+    int policy;
+    REQUIRE(parseSchedPolicy("fifo", policy));
+    REQUIRE(policy == SCHED_FIFO);
+    REQUIRE(parseSchedPolicy("rr", policy));
+    REQUIRE(policy == SCHED_RR);
+    REQUIRE_FALSE(parseSchedPolicy("idle", policy));
+
+    int min_priority, max_priority;
+    REQUIRE(schedPriorityRange("other", min_priority, max_priority));
+    REQUIRE(min_priority == 0);
+    REQUIRE(max_priority == 0);
+    REQUIRE(schedPriorityRange("fifo", min_priority, max_priority));
+    REQUIRE(min_priority >= 1);
+    REQUIRE(max_priority >= min_priority);
+}
+
+TEST_CASE("applyThreadProfile pins the calling thread", "[realtime]")
+{
+    std::string error;
+    // Default profile: nothing to change
+    REQUIRE(applyThreadProfile("", "other", 0, error));
+
+    cpu_set_t saved;
+    REQUIRE(sched_getaffinity(0, sizeof(saved), &saved) == 0);
+    int cpu = 0;
+    while (!CPU_ISSET(cpu, &saved))
+        ++cpu;
+
+    REQUIRE(applyThreadProfile(std::to_string(cpu), "other", 0, error));
+    cpu_set_t set;
+    REQUIRE(sched_getaffinity(0, sizeof(set), &set) == 0);
+    REQUIRE(CPU_COUNT(&set) == 1);
+    REQUIRE(CPU_ISSET(cpu, &set));
+
+    REQUIRE(sched_setaffinity(0, sizeof(saved), &saved) == 0);
+}
@@ -0,0 +1,672 @@
+#include "catch.hpp"
+#include <algorithm>
+#include "uds.h"
+#include "msg_batch.h"
+#include "udp.h"
+#include "udp_egress.h"
+#include "token_bucket.h"
+#include "latency_histogram.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <string>
+
+TEST_CASE("UdsSocket receiveBatch drains multiple datagrams per call", "[socket_batch]")
+{
+    const std::string server_path = "/tmp/fsl_test_batch_server";
+    UdsSocket server(server_path, "");
+    REQUIRE(server.bindSocket());
+    UdsSocket client("", server_path);
+
+    for (int i = 0; i < 5; ++i)
+    {
+        std::string msg = "msg" + std::to_string(i);
+        REQUIRE(client.send(msg.data(), msg.size()) == (ssize_t)msg.size());
+    }
+
+    MsgBatch batch(4, 64);
+    REQUIRE(server.receiveBatch(batch) == 4);
+    REQUIRE(batch.size() == 4);
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        std::string expected = "msg" + std::to_string(i);
+        REQUIRE(batch.length(i) == expected.size());
+        REQUIRE(memcmp(batch.data(i), expected.data(), expected.size()) == 0);
+        REQUIRE(!batch.truncated(i));
+    }
+
+    REQUIRE(server.receiveBatch(batch) == 1);
+    REQUIRE(std::string((const char *)batch.data(0), batch.length(0)) == "msg4");
+
+    // Nothing pending: non-blocking receive returns 0
+    REQUIRE(server.receiveBatch(batch) == 0);
+}
+
+TEST_CASE("UdsSocket receiveBatch flags truncated datagrams", "[socket_batch]")
+{
+    const std::string server_path = "/tmp/fsl_test_batch_trunc";
+    UdsSocket server(server_path, "");
+    REQUIRE(server.bindSocket());
+    UdsSocket client("", server_path);
+
+    std::string big(100, 'x');
+    REQUIRE(client.send(big.data(), big.size()) == (ssize_t)big.size());
+
+    MsgBatch batch(2, 16);
+    REQUIRE(server.receiveBatch(batch) == 1);
+    REQUIRE(batch.truncated(0));
+}
+
+TEST_CASE("UdpEgress batches datagrams until flushed", "[socket_batch]")
+{
+    UdpServerSocket receiver(19010, "127.0.0.1", 19910);
+    REQUIRE(receiver.bindSocket());
+    UdpServerSocket sender(19910, "127.0.0.1", 19010);
+    REQUIRE(sender.bindSocket());
+
+    UdpEgress egress(sender, 4, 1 << 20, 0);
+    for (int i = 0; i < 3; ++i)
+    {
+        uint8_t *buf = egress.acquire(1);
+        REQUIRE(buf != nullptr);
+        buf[0] = static_cast<uint8_t>(i);
+        egress.commit();
+    }
+    REQUIRE(egress.pending() == 3);
+    REQUIRE(egress.timeoutMs() == 0);
+
+    // Nothing reaches the socket until the batch is flushed
+    uint8_t rx[64];
+    REQUIRE(receiver.receive(rx, sizeof(rx)) < 0);
+
+    egress.flushIfDue();
+    REQUIRE(egress.pending() == 0);
+    REQUIRE(egress.timeoutMs() == -1);
+    for (int i = 0; i < 3; ++i)
+    {
+        REQUIRE(receiver.receive(rx, sizeof(rx)) == 1);
+        REQUIRE(rx[0] == i);
+    }
+
+    // A full batch is sent as soon as the last datagram is committed
+    for (int i = 0; i < 4; ++i)
+    {
+        egress.acquire(1)[0] = 0;
+        egress.commit();
+    }
+    REQUIRE(egress.pending() == 0);
+}
+
+// UDP socket whose kernel send buffer can be declared full
+struct StallingUdpSocket : public UdpServerSocket
+{
+    bool full = false;
+    std::vector<std::string> sent;
+    StallingUdpSocket() : UdpServerSocket(0, "127.0.0.1", 19010) {}
+    int sendBatch(mmsghdr *msgs, unsigned int count)
+    {
+        if (full)
+        {
+            errno = EAGAIN;
+            return -1;
+        }
+        for (unsigned int i = 0; i < count; ++i)
+            record(msgs[i].msg_hdr.msg_iov, msgs[i].msg_hdr.msg_iovlen);
+        return count;
+    }
+    ssize_t sendv(const iovec *iov, size_t iovcnt)
+    {
+        if (full)
+        {
+            errno = EAGAIN;
+            return -1;
+        }
+        return record(iov, iovcnt);
+    }
+    // GSO: supported flag, errno to fail sendSegmented() with (0 = success), segment sizes seen
+    bool gso = false;
+    int gso_errno = 0;
+    std::vector<size_t> gso_segment_sizes;
+    bool gsoSupported() const { return gso; }
+    ssize_t sendSegmented(const iovec *iov, size_t iovcnt, uint16_t segment_size)
+    {
+        if (gso_errno != 0)
+        {
+            errno = gso_errno;
+            return -1;
+        }
+        gso_segment_sizes.push_back(segment_size);
+        std::string bytes;
+        for (size_t i = 0; i < iovcnt; ++i)
+            bytes.append((const char *)iov[i].iov_base, iov[i].iov_len);
+        for (size_t off = 0; off < bytes.size(); off += segment_size)
+            sent.push_back(bytes.substr(off, segment_size));
+        return bytes.size();
+    }
+    ssize_t record(const iovec *iov, size_t iovcnt)
+    {
+        std::string datagram;
+        for (size_t i = 0; i < iovcnt; ++i)
+            datagram.append((const char *)iov[i].iov_base, iov[i].iov_len);
+        sent.push_back(datagram);
+        return datagram.size();
+    }
+};
+
+static bool queue_datagram(UdpEgress &egress, const std::string &payload)
+{
+    uint8_t *buf = egress.acquire(payload.size());
+    if (!buf)
+        return false;
+    memcpy(buf, payload.data(), payload.size());
+    egress.commit();
+    return true;
+}
+
+TEST_CASE("UdpEgress parks datagrams on EAGAIN and resumes on writable", "[socket_batch]")
+{
+    StallingUdpSocket udp;
+    UdpEgress egress(udp, 8, 1 << 17, 0);
+
+    udp.full = true;
+    REQUIRE(queue_datagram(egress, "a"));
+    REQUIRE(queue_datagram(egress, "b"));
+    egress.flushIfDue();
+    REQUIRE(egress.wantsWritable());
+    REQUIRE(egress.pending() == 2);
+    // While stalled there is nothing to time: wait for POLLOUT instead
+    REQUIRE(egress.timeoutMs() == -1);
+
+    REQUIRE(queue_datagram(egress, "c"));
+    udp.full = false;
+    egress.onWritable();
+    REQUIRE(!egress.wantsWritable());
+    REQUIRE(egress.pending() == 0);
+    REQUIRE(udp.sent == std::vector<std::string>{"a", "b", "c"});
+}
+
+TEST_CASE("UdpEgress applies the drop policy when the queue is full", "[socket_batch]")
+{
+    const std::string big(40000, 'x');
+
+    SECTION("drop newest")
+    {
+        StallingUdpSocket udp;
+        UdpEgress egress(udp, 8, 1 << 17, 0, EgressDropPolicy::DROP_NEWEST);
+        udp.full = true;
+        REQUIRE(queue_datagram(egress, big + "1"));
+        egress.flush();
+        REQUIRE(queue_datagram(egress, big + "2"));
+        REQUIRE(queue_datagram(egress, big + "3"));
+        REQUIRE(!queue_datagram(egress, big + "4"));
+        REQUIRE(egress.dropped() == 1);
+
+        udp.full = false;
+        egress.onWritable();
+        REQUIRE(udp.sent.size() == 3);
+        REQUIRE(udp.sent.back() == big + "3");
+    }
+
+    SECTION("drop oldest")
+    {
+        StallingUdpSocket udp;
+        UdpEgress egress(udp, 8, 1 << 17, 0, EgressDropPolicy::DROP_OLDEST);
+        udp.full = true;
+        REQUIRE(queue_datagram(egress, big + "1"));
+        egress.flush();
+        REQUIRE(queue_datagram(egress, big + "2"));
+        REQUIRE(queue_datagram(egress, big + "3"));
+        REQUIRE(queue_datagram(egress, big + "4"));
+        REQUIRE(egress.dropped() == 1);
+
+        udp.full = false;
+        egress.onWritable();
+        REQUIRE(udp.sent.size() == 3);
+        REQUIRE(udp.sent.front() == big + "2");
+        REQUIRE(udp.sent.back() == big + "4");
+    }
+}
+
+TEST_CASE("UdpEgress wraps around the ring in order", "[socket_batch]")
+{
+    StallingUdpSocket udp;
+    UdpEgress egress(udp, 2, 1 << 17, 0);
+    std::vector<std::string> expected;
+    for (int i = 0; i < 50; ++i)
+    {
+        std::string payload(1000 + i * 997 % 30000, static_cast<char>('a' + i % 26));
+        expected.push_back(payload);
+        udp.full = (i % 3 == 0);
+        REQUIRE(queue_datagram(egress, payload));
+        if (!udp.full)
+            egress.onWritable();
+    }
+    udp.full = false;
+    egress.onWritable();
+    REQUIRE(udp.sent == expected);
+}
+
+// Build count two-segment datagrams (header + payload) as the downlink path stages them
+static void make_datagrams(mmsghdr *msgs, iovec (*iovs)[2], char *headers, char **payloads, size_t count)
+{
+    memset(msgs, 0, count * sizeof(mmsghdr));
+    for (size_t i = 0; i < count; ++i)
+    {
+        iovs[i][0] = {&headers[i], 1};
+        iovs[i][1] = {payloads[i], strlen(payloads[i])};
+        msgs[i].msg_hdr.msg_iov = iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 2;
+    }
+}
+
+TEST_CASE("UdpEgress send() transmits from caller memory and copies only what must wait", "[socket_batch]")
+{
+    StallingUdpSocket udp;
+    UdpEgress egress(udp, 4, 1 << 17, 0);
+
+    char headers[] = "HH";
+    char a[] = "first", b[] = "second";
+    char *payloads[] = {a, b};
+    iovec iovs[2][2];
+    mmsghdr msgs[2];
+    make_datagrams(msgs, iovs, headers, payloads, 2);
+
+    // Empty queue, writable socket: sent directly (segments gathered by the kernel), nothing queued
+    REQUIRE(egress.send(msgs, 2) == 2);
+    REQUIRE(egress.pending() == 0);
+    REQUIRE(udp.sent == std::vector<std::string>{"Hfirst", "Hsecond"});
+
+    // Socket full: both datagrams are gathered into the ring, so the caller may reuse its buffers
+    udp.sent.clear();
+    udp.full = true;
+    REQUIRE(egress.send(msgs, 2) == 2);
+    REQUIRE(egress.pending() == 2);
+    memset(a, 'X', 5);
+    memset(b, 'Y', 6);
+    headers[0] = headers[1] = 'Z';
+
+    // Queue not empty: a direct send would overtake it, so this one is queued too
+    char h = 'h';
+    char c[] = "third";
+    char *more_payloads[] = {c};
+    iovec more_iovs[1][2];
+    mmsghdr more;
+    make_datagrams(&more, more_iovs, &h, more_payloads, 1);
+    udp.full = false;
+    REQUIRE(egress.send(&more, 1) == 1);
+    REQUIRE(udp.sent.empty());
+
+    egress.onWritable();
+    REQUIRE(udp.sent == std::vector<std::string>{"Hfirst", "Hsecond", "hthird"});
+
+    // Single datagram on an idle queue goes out through sendv()
+    udp.sent.clear();
+    REQUIRE(egress.send(&more, 1) == 1);
+    REQUIRE(egress.pending() == 0);
+    REQUIRE(udp.sent == std::vector<std::string>{"hthird"});
+}
+
+TEST_CASE("UdpEgress reports tagged datagrams it evicts to the dropped hook", "[socket_batch]")
+{
+    StallingUdpSocket udp;
+    UdpEgress egress(udp, 8, 1 << 17, 0, EgressDropPolicy::DROP_OLDEST);
+    std::vector<uint32_t> dropped_ids;
+    egress.setDroppedHook([&dropped_ids](const UdpEgress::DatagramTag &tag)
+                          { dropped_ids.push_back(tag.id); });
+
+    std::string big(40000, 'x');
+    char header = 'H';
+    char *payloads[] = {&big[0]};
+    iovec iovs[1][2];
+    mmsghdr msg;
+    make_datagrams(&msg, iovs, &header, payloads, 1);
+
+    udp.full = true;
+    for (uint32_t id = 1; id <= 4; ++id)
+    {
+        UdpEgress::DatagramTag tag = {id, 0};
+        REQUIRE(egress.send(&msg, 1, &tag) == 1);
+    }
+    // Room for three: the oldest one made way for the fourth
+    REQUIRE(egress.pending() == 3);
+    REQUIRE(egress.dropped() == 1);
+    REQUIRE(dropped_ids == std::vector<uint32_t>{1});
+
+    // Untagged entries are evicted without a report
+    REQUIRE(queue_datagram(egress, big));
+    REQUIRE(dropped_ids == std::vector<uint32_t>{1, 2});
+    REQUIRE(queue_datagram(egress, big));
+    REQUIRE(queue_datagram(egress, big));
+    REQUIRE(queue_datagram(egress, big));
+    REQUIRE(egress.dropped() == 5);
+    REQUIRE(dropped_ids == std::vector<uint32_t>{1, 2, 3, 4});
+}
+
+TEST_CASE("UdpEgress reports tagged datagrams to the sent hook when the kernel takes them", "[socket_batch]")
+{
+    StallingUdpSocket udp;
+    UdpEgress egress(udp, 4, 1 << 17, 0);
+    std::vector<UdpEgress::DatagramTag> reported;
+    egress.setSentHook([&reported](const UdpEgress::DatagramTag &tag, int64_t sent_ns)
+                       {
+                           REQUIRE(sent_ns >= tag.time_ns);
+                           reported.push_back(tag);
+                       });
+
+    char headers[] = "HHH";
+    char a[] = "a", b[] = "b", c[] = "c";
+    char *payloads[] = {a, b, c};
+    iovec iovs[3][2];
+    mmsghdr msgs[3];
+    make_datagrams(msgs, iovs, headers, payloads, 3);
+    const int64_t now = LatencyHistogram::nowNs();
+    UdpEgress::DatagramTag tags[3] = {{1, now}, {UdpEgress::NO_TAG, 0}, {3, now}};
+
+    // Sent directly: reported during the call, untagged datagram skipped
+    REQUIRE(egress.send(msgs, 3, tags) == 3);
+    REQUIRE(reported.size() == 2);
+    REQUIRE(reported[0].id == 1);
+    REQUIRE(reported[1].id == 3);
+    REQUIRE(reported[1].time_ns == now);
+
+    // Parked in the ring: reported only once actually sent, with the tag kept in the entry
+    reported.clear();
+    udp.full = true;
+    REQUIRE(egress.send(msgs, 3, tags) == 3);
+    REQUIRE(reported.empty());
+    udp.full = false;
+    egress.onWritable();
+    REQUIRE(egress.pending() == 0);
+    REQUIRE(reported.size() == 2);
+    REQUIRE(reported[0].id == 1);
+    REQUIRE(reported[1].id == 3);
+    REQUIRE(reported[1].time_ns == now);
+
+    // Datagrams written with acquire()/commit() carry no tag
+    reported.clear();
+    REQUIRE(queue_datagram(egress, "x"));
+    egress.flush();
+    REQUIRE(udp.sent.back() == "x");
+    REQUIRE(reported.empty());
+}
+
+TEST_CASE("UdpEgress sends runs of equal datagrams with GSO and falls back when rejected", "[socket_batch]")
+{
+    StallingUdpSocket udp;
+    UdpEgress egress(udp, 4, 1 << 17, 0);
+    REQUIRE(!egress.enableGso(8)); // not supported: stays off
+    udp.gso = true;
+    REQUIRE(egress.enableGso(8));
+
+    // 5 x "aaaa" + "bb" form one run (the last segment may be shorter); "cccccc" does not fit it
+    std::vector<std::string> payloads = {"aaaa", "aaaa", "aaaa", "aaaa", "aaaa", "bb", "cccccc"};
+    std::vector<iovec> iovs(payloads.size());
+    std::vector<mmsghdr> msgs(payloads.size());
+    memset(msgs.data(), 0, msgs.size() * sizeof(mmsghdr));
+    for (size_t i = 0; i < payloads.size(); ++i)
+    {
+        iovs[i] = {&payloads[i][0], payloads[i].size()};
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    REQUIRE(egress.send(msgs.data(), msgs.size()) == msgs.size());
+    REQUIRE(udp.sent == payloads);
+    REQUIRE(udp.gso_segment_sizes == std::vector<size_t>{4});
+    REQUIRE(egress.stats().gso_sends == 1);
+    REQUIRE(egress.stats().gso_datagrams == 6);
+    REQUIRE(egress.stats().datagrams == 7);
+    REQUIRE(egress.stats().send_calls == 2);
+
+    // Segment size rejected: sent without GSO, GSO kept for smaller segments
+    udp.sent.clear();
+    udp.gso_errno = EINVAL;
+    REQUIRE(egress.send(msgs.data(), 5) == 5);
+    REQUIRE(udp.sent.size() == 5);
+    REQUIRE(egress.gsoEnabled());
+
+    // Any other failure turns GSO off
+    UdpEgress other(udp, 4, 1 << 17, 0);
+    REQUIRE(other.enableGso(8));
+    udp.sent.clear();
+    udp.gso_errno = EIO;
+    REQUIRE(other.send(msgs.data(), 5) == 5);
+    REQUIRE(udp.sent.size() == 5);
+    REQUIRE(!other.gsoEnabled());
+}
+
+TEST_CASE("UdpEgress paces datagrams with a token bucket without blocking", "[socket_batch]")
+{
+    StallingUdpSocket udp;
+    UdpEgress egress(udp, 8, 1 << 17, 0);
+    // 8000 bit/s = 1 byte per ms; a 10-byte bucket lets two 4-byte datagrams through at once
+    TokenBucket shaper(8000, 10);
+    egress.setShaper(&shaper);
+
+    std::vector<std::string> payloads = {"aaaa", "bbbb", "cccc", "dddd"};
+    std::vector<iovec> iovs(payloads.size());
+    std::vector<mmsghdr> msgs(payloads.size());
+    memset(msgs.data(), 0, msgs.size() * sizeof(mmsghdr));
+    for (size_t i = 0; i < payloads.size(); ++i)
+    {
+        iovs[i] = {&payloads[i][0], payloads[i].size()};
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // The burst goes out directly, the rest waits in the ring with a timeout instead of POLLOUT
+    REQUIRE(egress.send(msgs.data(), msgs.size()) == msgs.size());
+    REQUIRE(udp.sent == std::vector<std::string>{"aaaa", "bbbb"});
+    REQUIRE(egress.pending() == 2);
+    REQUIRE(egress.throttled());
+    REQUIRE(!egress.wantsWritable());
+    int timeout = egress.timeoutMs();
+    REQUIRE(timeout >= 1);
+    REQUIRE(timeout <= 3);
+    egress.flushIfDue();
+    REQUIRE(udp.sent.size() == 2);
+
+    // Once the tokens are there, the next datagram goes
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+    egress.flushIfDue();
+    REQUIRE(udp.sent.size() >= 3);
+
+    // Lifting the limit at runtime releases the rest on the next flush
+    shaper.configure(0, 10);
+    egress.flushIfDue();
+    REQUIRE(udp.sent == payloads);
+    REQUIRE(!egress.throttled());
+    REQUIRE(egress.stats().shaper_waits >= 1);
+}
+
+TEST_CASE("UdpServerSocket sendSegmented splits one send into datagrams", "[socket_batch]")
+{
+    UdpServerSocket receiver(19013, "127.0.0.1", 19913);
+    REQUIRE(receiver.bindSocket());
+    UdpServerSocket sender(19913, "127.0.0.1", 19013);
+    REQUIRE(sender.bindSocket());
+    if (!sender.gsoSupported())
+    {
+        WARN("UDP GSO not supported, skipping");
+        return;
+    }
+
+    char header[] = "HH";
+    char payload[] = "0123456789";
+    iovec iov[2] = {{header, 2}, {payload, 10}};
+    REQUIRE(sender.sendSegmented(iov, 2, 5) == 12);
+
+    MsgBatch batch(8, 64);
+    REQUIRE(receiver.receiveBatch(batch) == 3);
+    REQUIRE(std::string((const char *)batch.data(0), batch.length(0)) == "HH012");
+    REQUIRE(std::string((const char *)batch.data(1), batch.length(1)) == "34567");
+    REQUIRE(std::string((const char *)batch.data(2), batch.length(2)) == "89");
+}
+
+TEST_CASE("UdpServerSocket with GRO reports the segment size of coalesced datagrams", "[socket_batch]")
+{
+    UdpServerSocket receiver(19014, "127.0.0.1", 19914);
+    REQUIRE(receiver.bindSocket());
+    UdpServerSocket sender(19914, "127.0.0.1", 19014);
+    REQUIRE(sender.bindSocket());
+    if (!receiver.enableGro() || !sender.gsoSupported())
+    {
+        WARN("UDP GRO/GSO not supported, skipping");
+        return;
+    }
+
+    // A GSO train over loopback reaches a GRO socket as one coalesced datagram
+    char payload[] = "aaaaabbbbbcc";
+    iovec iov = {payload, 12};
+    REQUIRE(sender.sendSegmented(&iov, 1, 5) == 12);
+
+    MsgBatch batch(8, 64);
+    batch.enableSegmentInfo();
+    int n = receiver.receiveBatch(batch);
+    REQUIRE(n >= 1);
+
+    // Split back into the original datagrams, whether or not they were coalesced
+    std::vector<std::string> frames;
+    for (int k = 0; k < n; ++k)
+    {
+        size_t length = batch.length(k);
+        size_t segment = batch.segmentSize(k);
+        if (segment == 0)
+            segment = length;
+        for (size_t off = 0; off < length; off += segment)
+            frames.emplace_back((const char *)batch.data(k) + off, std::min(segment, length - off));
+    }
+    REQUIRE(frames == std::vector<std::string>{"aaaaa", "bbbbb", "cc"});
+    if (n == 1)
+        REQUIRE(batch.segmentSize(0) == 5);
+}
+
+TEST_CASE("UdsSocket sendv gathers segments into one datagram", "[socket_batch]")
+{
+    const std::string server_path = "/tmp/fsl_test_sendv_dst";
+    UdsSocket server(server_path, "");
+    REQUIRE(server.bindSocket());
+    UdsSocket client("", server_path);
+
+    char header[] = "HDR:";
+    char payload[] = "payload";
+    iovec iov[2] = {{header, 4}, {payload, 7}};
+    REQUIRE(client.sendv(iov, 2) == 11);
+
+    char buf[64];
+    ssize_t n = server.receive(buf, sizeof(buf));
+    REQUIRE(n == 11);
+    REQUIRE(std::string(buf, n) == "HDR:payload");
+}
+
+TEST_CASE("UdsSocket reports kernel receive timestamps once enabled", "[socket_batch]")
+{
+    const std::string server_path = "/tmp/fsl_test_timestamps";
+    UdsSocket server(server_path, "");
+    REQUIRE(server.bindSocket());
+    REQUIRE(server.enableTimestamps());
+    UdsSocket client("", server_path);
+
+    const int64_t before = LatencyHistogram::nowNs();
+    REQUIRE(client.send("one", 3) == 3);
+    REQUIRE(client.send("two", 3) == 3);
+    REQUIRE(client.send("three", 5) == 5);
+
+    // Single receive
+    char buf[16];
+    int64_t receive_ns = 0;
+    REQUIRE(server.receive(buf, sizeof(buf), receive_ns) == 3);
+    REQUIRE(receive_ns >= before);
+    REQUIRE(receive_ns <= LatencyHistogram::nowNs());
+
+    // Batch receive: one timestamp per datagram, in order
+    MsgBatch batch(4, 16);
+    batch.enableTimestamps();
+    REQUIRE(server.receiveBatch(batch) == 2);
+    REQUIRE(batch.receiveTimeNs(0) >= receive_ns);
+    REQUIRE(batch.receiveTimeNs(1) >= batch.receiveTimeNs(0));
+    REQUIRE(std::string((const char *)batch.data(1), batch.length(1)) == "three");
+
+    // Batch without room for ancillary data: no timestamp
+    REQUIRE(client.send("four", 4) == 4);
+    MsgBatch plain(1, 16);
+    REQUIRE(server.receiveBatch(plain) == 1);
+    REQUIRE(plain.receiveTimeNs(0) == 0);
+}
+
+TEST_CASE("UdpServerSocket receiveBatch reports length and sender per datagram", "[socket_batch]")
+{
+    UdpServerSocket receiver(19011, "127.0.0.1", 19911);
+    REQUIRE(receiver.bindSocket());
+    UdpServerSocket sender_a(19911, "127.0.0.1", 19011);
+    REQUIRE(sender_a.bindSocket());
+    UdpServerSocket sender_b(19912, "127.0.0.1", 19011);
+    REQUIRE(sender_b.bindSocket());
+
+    REQUIRE(sender_a.send("a", 1) == 1);
+    REQUIRE(sender_b.send("bb", 2) == 2);
+
+    MsgBatch batch(8, 64);
+    REQUIRE(receiver.receiveBatch(batch) == 2);
+    REQUIRE(batch.length(0) == 1);
+    REQUIRE(batch.length(1) == 2);
+
+    const sockaddr_in *addr_a = reinterpret_cast<const sockaddr_in *>(&batch.senderAddr(0));
+    const sockaddr_in *addr_b = reinterpret_cast<const sockaddr_in *>(&batch.senderAddr(1));
+    REQUIRE(addr_a->sin_family == AF_INET);
+    REQUIRE(ntohs(addr_a->sin_port) == 19911);
+    REQUIRE(ntohs(addr_b->sin_port) == 19912);
+
+    REQUIRE(receiver.receiveBatch(batch) == 0);
+}
+
+TEST_CASE("UdpServerSocket on an ephemeral port sends to its connected remote", "[socket_batch]")
+{
+    UdpServerSocket receiver(19015, "127.0.0.1", 0);
+    REQUIRE(receiver.bindSocket());
+    // Downlink shard socket: any local port, connected to the GSL endpoint
+    UdpServerSocket shard(0, "127.0.0.1", 19015);
+    REQUIRE(shard.bindSocket());
+    REQUIRE(shard.connectRemote());
+
+    char header[] = "H";
+    char payload[] = "pp";
+    iovec iov[2] = {{header, 1}, {payload, 2}};
+    REQUIRE(shard.sendv(iov, 2) == 3);
+    REQUIRE(shard.send("x", 1) == 1);
+
+    MsgBatch batch(8, 64);
+    REQUIRE(receiver.receiveBatch(batch) == 2);
+    REQUIRE(std::string((const char *)batch.data(0), batch.length(0)) == "Hpp");
+    const sockaddr_in *addr = reinterpret_cast<const sockaddr_in *>(&batch.senderAddr(0));
+    REQUIRE(ntohs(addr->sin_port) != 0);
+}
+
+TEST_CASE("UdsSocket sendBatch sends several datagrams in one call", "[socket_batch]")
+{
+    const std::string server_path = "/tmp/fsl_test_batch_client_dst";
+    UdsSocket server(server_path, "");
+    REQUIRE(server.bindSocket());
+    UdsSocket client("", server_path);
+
+    const char *payloads[] = {"one", "two", "three"};
+    iovec iovecs[3];
+    mmsghdr msgs[3];
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < 3; ++i)
+    {
+        iovecs[i].iov_base = const_cast<char *>(payloads[i]);
+        iovecs[i].iov_len = strlen(payloads[i]);
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    REQUIRE(client.sendBatch(msgs, 3) == 3);
+
+    MsgBatch batch(4, 64);
+    REQUIRE(server.receiveBatch(batch) == 3);
+    for (int i = 0; i < 3; ++i)
+        REQUIRE(std::string((const char *)batch.data(i), batch.length(i)) == payloads[i]);
+}
@@ -0,0 +1,50 @@
+#include "catch.hpp"
+#include "token_bucket.h"
+
+TEST_CASE("TokenBucket allows a burst, then paces at the rate", "[token_bucket]")
+{
+    // 8 Mbit/s = 1 byte per microsecond, 1000-byte bucket
+    TokenBucket bucket(8000000, 1000);
+    const int64_t t0 = 1000000000;
+    REQUIRE(bucket.enabled());
+
+    // A full bucket takes the burst at once
+    REQUIRE(bucket.delayNs(1000, t0) == 0);
+    bucket.consume(1000, t0);
+    REQUIRE(bucket.delayNs(100, t0) == 100000);
+
+    // Tokens come back at the rate
+    REQUIRE(bucket.delayNs(100, t0 + 100000) == 0);
+    bucket.consume(100, t0 + 100000);
+    REQUIRE(bucket.delayNs(100, t0 + 100000) == 100000);
+
+    // An idle bucket fills up to the burst only
+    REQUIRE(bucket.delayNs(1000, t0 + 10000000) == 0);
+    REQUIRE(bucket.delayNs(1001, t0 + 10000000) == 0); // larger than the burst: allowed when full
+    bucket.consume(1500, t0 + 10000000);
+    REQUIRE(bucket.delayNs(1, t0 + 10000000) == 501000);
+}
+
+TEST_CASE("TokenBucket is reconfigured at runtime and disabled by rate 0", "[token_bucket]")
+{
+    TokenBucket bucket(8000, 100);
+    const int64_t t0 = 1000000000;
+    bucket.consume(100, t0);
+    REQUIRE(bucket.delayNs(10, t0) == 10000000);
+
+    // New settings start with a full bucket
+    bucket.configure(80000, 200);
+    REQUIRE(bucket.rateBps() == 80000);
+    REQUIRE(bucket.burstBytes() == 200);
+    REQUIRE(bucket.delayNs(200, t0) == 0);
+
+    bucket.configure(0, 200);
+    REQUIRE(!bucket.enabled());
+    bucket.consume(100000, t0);
+    REQUIRE(bucket.delayNs(100000, t0) == 0);
+
+    // Out-of-range settings are clamped
+    bucket.configure(TokenBucket::MAX_RATE_BPS + 1, TokenBucket::MAX_BURST_BYTES + 1);
+    REQUIRE(bucket.rateBps() == TokenBucket::MAX_RATE_BPS);
+    REQUIRE(bucket.burstBytes() == TokenBucket::MAX_BURST_BYTES);
+}
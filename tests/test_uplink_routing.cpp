@@ -0,0 +1,106 @@
+#include "catch.hpp"
+#include "../src/app.h"
+#include "test_utils.h"
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Exposes the uplink router and its compiled table
+struct RoutingTestApp : public App
+{
+    using App::flushUplink;
+    using App::stageUplink;
+    using App::ul_route_table_;
+    using App::ul_routes_;
+    using App::ul_unrouted_;
+    explicit RoutingTestApp(const AppConfig &config) : App(config) {}
+};
+
+static std::vector<uint8_t> uplinkFrame(uint16_t opcode, const std::string &payload)
+{
+    GslFslHeader hdr = {};
+    hdr.opcode = opcode;
+    hdr.length = static_cast<uint32_t>(payload.size());
+    std::vector<uint8_t> frame(GSL_FSL_HEADER_SIZE + payload.size());
+    memcpy(frame.data(), &hdr, GSL_FSL_HEADER_SIZE);
+    memcpy(frame.data() + GSL_FSL_HEADER_SIZE, payload.data(), payload.size());
+    return frame;
+}
+
+TEST_CASE("Uplink routing table maps every configured opcode and nothing else", "[uplink_routing]")
+{
+    AppConfig cfg = load_config(get_test_config_path().c_str(), -1);
+    RoutingTestApp app(cfg);
+
+    REQUIRE(app.ul_routes_.size() == cfg.ul_uds_mapping.size());
+    size_t mapped = 0;
+    for (size_t opcode = 0; opcode <= UINT16_MAX; ++opcode)
+    {
+        if (app.ul_route_table_[opcode])
+            ++mapped;
+    }
+    REQUIRE(mapped == cfg.ul_uds_mapping.size());
+    for (const auto &mapping : cfg.ul_uds_mapping)
+    {
+        REQUIRE(app.ul_route_table_[mapping.first] != nullptr);
+        REQUIRE(app.ul_route_table_[mapping.first]->group->name == mapping.second);
+    }
+}
+
+TEST_CASE("Uplink datagrams are routed by opcode and counted per route", "[uplink_routing]")
+{
+    AppConfig cfg = load_config(get_test_config_path().c_str(), -1);
+    RoutingTestApp app(cfg);
+    const uint16_t opcode = cfg.ul_uds_mapping.begin()->first;
+    UdsSocket receiver(cfg.uds_clients.at(cfg.ul_uds_mapping.begin()->second), "");
+    REQUIRE(receiver.bindSocket());
+
+    std::vector<uint8_t> first = uplinkFrame(opcode, "cmd1");
+    std::vector<uint8_t> second = uplinkFrame(opcode, "cmd22");
+    std::vector<uint8_t> unmapped = uplinkFrame(0xBEEF, "lost");
+    const int64_t receive_ns = LatencyHistogram::nowNs();
+    app.stageUplink(first.data(), first.size(), false, receive_ns);
+    app.stageUplink(unmapped.data(), unmapped.size());
+    app.stageUplink(second.data(), second.size());
+    app.flushUplink();
+
+    char buf[64];
+    ssize_t n = receiver.receive(buf, sizeof(buf));
+    REQUIRE(std::string(buf, n > 0 ? n : 0) == "cmd1");
+    n = receiver.receive(buf, sizeof(buf));
+    REQUIRE(std::string(buf, n > 0 ? n : 0) == "cmd22");
+
+    const auto &route = *app.ul_route_table_[opcode];
+    REQUIRE(route.counters.datagrams == 2);
+    REQUIRE(route.counters.bytes == 9);
+    REQUIRE(route.counters.drops == 0);
+    REQUIRE(app.ul_unrouted_ == 1);
+    // Only the datagram staged with a receive time is measured
+    LatencyHistogram::Snapshot latency = route.latency.snapshot();
+    REQUIRE(latency.count == 1);
+    REQUIRE(latency.max_ns <= static_cast<uint64_t>(LatencyHistogram::nowNs() - receive_ns));
+}
+
+TEST_CASE("Uplink datagrams a client does not take are counted on their route", "[uplink_routing]")
+{
+    AppConfig cfg = load_config(get_test_config_path().c_str(), -1);
+    RoutingTestApp app(cfg);
+    const uint16_t opcode = cfg.ul_uds_mapping.begin()->first;
+    unlink(cfg.uds_clients.at(cfg.ul_uds_mapping.begin()->second).c_str());
+
+    // No receiver bound: every send fails
+    std::vector<uint8_t> first = uplinkFrame(opcode, "cmd1");
+    std::vector<uint8_t> second = uplinkFrame(opcode, "cmd2");
+    app.stageUplink(first.data(), first.size());
+    app.flushUplink();
+    app.stageUplink(first.data(), first.size());
+    app.stageUplink(second.data(), second.size(), true);
+    app.flushUplink();
+
+    const auto &route = *app.ul_route_table_[opcode];
+    REQUIRE(route.counters.datagrams == 3);
+    REQUIRE(route.counters.drops == 3);
+    REQUIRE(route.counters.eagain == 0); // no socket, not a full one
+    REQUIRE(route.counters.truncated == 1);
+}
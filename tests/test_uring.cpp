@@ -0,0 +1,121 @@
+#include "catch.hpp"
+#include "uring.h"
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef FSL_HAVE_IO_URING
+
+// Create a ring, or nullptr if the running kernel does not support what FSL needs
+static std::unique_ptr<IoUring> makeRing(unsigned entries)
+{
+    try
+    {
+        return std::unique_ptr<IoUring>(new IoUring(entries));
+    }
+    catch (const std::runtime_error &e)
+    {
+        WARN("io_uring not available, skipping: " << e.what());
+        return nullptr;
+    }
+}
+
+TEST_CASE("IoUring multishot receive picks buffers from the provided ring", "[uring]")
+{
+    std::unique_ptr<IoUring> ring = makeRing(16);
+    if (!ring)
+        return;
+    IoUringBufferRing buffers(*ring, 3, 4, 256);
+
+    int sv[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) == 0);
+    const char *msgs[] = {"one", "two", "three"};
+    for (const char *m : msgs)
+        REQUIRE(send(sv[1], m, strlen(m), 0) == (ssize_t)strlen(m));
+
+    REQUIRE(ring->prepRecvMultishot(sv[0], buffers.groupId(), 42) != nullptr);
+
+    std::vector<std::string> got;
+    while (got.size() < 3)
+    {
+        REQUIRE(ring->submitAndWait(true, 1000) == 0);
+        io_uring_cqe *cqe;
+        while ((cqe = ring->peekCqe()) != nullptr)
+        {
+            REQUIRE(cqe->user_data == 42);
+            REQUIRE(cqe->res > 0);
+            REQUIRE((cqe->flags & IORING_CQE_F_BUFFER));
+            REQUIRE((cqe->flags & IORING_CQE_F_MORE)); // still armed
+            uint16_t bid = static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            got.emplace_back(reinterpret_cast<const char *>(buffers.buffer(bid)), cqe->res);
+            buffers.recycle(bid);
+            ring->seenCqe();
+        }
+    }
+    REQUIRE(got == std::vector<std::string>{"one", "two", "three"});
+    REQUIRE(ring->enterCalls() >= 1);
+
+    close(sv[0]);
+    close(sv[1]);
+}
+
+TEST_CASE("IoUring linked sendmsg chain sends header and payload iovecs in order", "[uring]")
+{
+    std::unique_ptr<IoUring> ring = makeRing(16);
+    if (!ring)
+        return;
+
+    int sv[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) == 0);
+
+    const int count = 4;
+    char headers[count][2];
+    const char payload[] = "payload";
+    iovec iovs[count][2];
+    msghdr msgs[count];
+    io_uring_sqe *prev = nullptr;
+    for (int i = 0; i < count; ++i)
+    {
+        headers[i][0] = 'h';
+        headers[i][1] = static_cast<char>('0' + i);
+        iovs[i][0] = {headers[i], 2};
+        iovs[i][1] = {const_cast<char *>(payload), sizeof(payload) - 1};
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_iov = iovs[i];
+        msgs[i].msg_iovlen = 2;
+        io_uring_sqe *sqe = ring->prepSendMsg(sv[1], &msgs[i], i);
+        REQUIRE(sqe != nullptr);
+        if (prev)
+            IoUring::linkNext(prev);
+        prev = sqe;
+    }
+
+    int completed = 0;
+    while (completed < count)
+    {
+        REQUIRE(ring->submitAndWait(true, 1000) == 0);
+        io_uring_cqe *cqe;
+        while ((cqe = ring->peekCqe()) != nullptr)
+        {
+            REQUIRE(cqe->res == 9);
+            ++completed;
+            ring->seenCqe();
+        }
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        char buf[32];
+        ssize_t n = recv(sv[0], buf, sizeof(buf), MSG_DONTWAIT);
+        REQUIRE(n == 9);
+        REQUIRE(std::string(buf, n) == std::string("h") + static_cast<char>('0' + i) + "payload");
+    }
+
+    close(sv[0]);
+    close(sv[1]);
+}
+
+#endif // FSL_HAVE_IO_URING
@@ -3,6 +3,8 @@
 #include <cstdlib>
 #include <libgen.h>
 #include <fstream>
+#include <cstdio>
+#include <unistd.h>
 
 // Returns the absolute path to config.xml
 inline std::string get_test_config_path()
@@ -22,3 +24,63 @@ inline std::string get_test_config_path()
     std::string output_dir = build_dir.substr(0, build_dir.length() - 6); // remove 'build/'
     return output_dir + "src/config.xml";
 }
+
+// Redirects stdout and stderr to a temporary file while in scope
+class CaptureOutput
+{
+public:
+    CaptureOutput()
+    {
+        std::fflush(stdout);
+        std::fflush(stderr);
+        saved_out_ = dup(STDOUT_FILENO);
+        saved_err_ = dup(STDERR_FILENO);
+        file_ = std::tmpfile();
+        dup2(fileno(file_), STDOUT_FILENO);
+        dup2(fileno(file_), STDERR_FILENO);
+    }
+
+    ~CaptureOutput()
+    {
+        restore();
+        std::fclose(file_);
+    }
+
+    // Restore the streams and return what was written
+    std::string text()
+    {
+        restore();
+        std::string result;
+        char buf[4096];
+        std::rewind(file_);
+        size_t n;
+        while ((n = std::fread(buf, 1, sizeof(buf), file_)) > 0)
+            result.append(buf, n);
+        return result;
+    }
+
+private:
+    void restore()
+    {
+        if (saved_out_ < 0)
+            return;
+        dup2(saved_out_, STDOUT_FILENO);
+        dup2(saved_err_, STDERR_FILENO);
+        close(saved_out_);
+        close(saved_err_);
+        saved_out_ = saved_err_ = -1;
+    }
+
+    int saved_out_ = -1;
+    int saved_err_ = -1;
+    FILE *file_ = nullptr;
+};
+
+// Number of non-overlapping occurrences of needle in text
+inline size_t countOccurrences(const std::string &text, const std::string &needle)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + needle.size()))
+        ++count;
+    return count;
+}